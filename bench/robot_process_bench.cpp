@@ -0,0 +1,345 @@
+/*!*******************************************************************************************
+ *  \file       robot_process_bench.cpp
+ *  \brief      Benchmark suite of RobotProcess.
+ *  \details    This file measures the cost of the state functions, the overhead of run(), the
+ *              round trip of the start and stop services and the time to set up processes, and
+ *              writes the results in JSON format.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <std_srvs/Empty.h>
+
+#include "robot_process.h"
+#include "in_process_transport.h"
+#include "ros_transport.h"
+
+namespace
+{
+typedef std::chrono::steady_clock Clock;
+
+//! Result of a benchmark. Percentiles are only available for benchmarks that time every operation.
+struct Result
+{
+  std::string name;
+  uint64_t iterations;
+  double mean_ns;
+  bool has_percentiles;
+  LatencyHistogram::Snapshot percentiles;
+  std::string skipped;  // Reason why the benchmark was not executed, empty if it was.
+};
+
+class EmptyProcess : public RobotProcess
+{
+public:
+  ~EmptyProcess()
+  {
+    shutdown();
+  }
+
+protected:
+  void ownSetUp()
+  {
+  }
+  void ownStart()
+  {
+  }
+  void ownStop()
+  {
+  }
+  void ownRun()
+  {
+  }
+};
+
+int64_t elapsedNs(Clock::time_point start, Clock::time_point end)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+// Returns a transport that does not register the process in the state board nor publishes periodically.
+std::shared_ptr<InProcessTransport> quietTransport(const std::string& name)
+{
+  std::shared_ptr<InProcessTransport> transport = std::make_shared<InProcessTransport>(name);
+  transport->setParam("heartbeat_rate", 0.0);
+  transport->setParam("metrics_rate", 0.0);
+  transport->setParam("state_board", false);
+  return transport;
+}
+
+Result batchResult(const std::string& name, uint64_t iterations, int64_t total_ns)
+{
+  Result result;
+  result.name = name;
+  result.iterations = iterations;
+  result.mean_ns = static_cast<double>(total_ns) / iterations;
+  result.has_percentiles = false;
+  return result;
+}
+
+Result sampledResult(const std::string& name, LatencyHistogram& histogram, int64_t total_ns)
+{
+  Result result = batchResult(name, histogram.totalCount(), total_ns);
+  result.has_percentiles = true;
+  result.percentiles = histogram.takeSnapshot();
+  return result;
+}
+
+Result skippedResult(const std::string& name, const std::string& reason)
+{
+  Result result;
+  result.name = name;
+  result.iterations = 0;
+  result.mean_ns = 0;
+  result.has_percentiles = false;
+  result.skipped = reason;
+  return result;
+}
+
+Result benchmarkGetState(uint64_t iterations)
+{
+  EmptyProcess process;
+  uint64_t running = 0;
+  const Clock::time_point start = Clock::now();
+  for (uint64_t i = 0; i < iterations; i++)
+    running += process.getState() == RobotProcess::State::RUNNING;
+  const Clock::time_point end = Clock::now();
+  if (running != 0)
+    fprintf(stderr, "Unexpected state\n");
+  return batchResult("get_state", iterations, elapsedNs(start, end));
+}
+
+Result benchmarkSetState(uint64_t iterations)
+{
+  EmptyProcess process;
+  process.setTransport(quietTransport("/bench_set_state"));
+  process.setUp();
+  process.start();
+
+  // Every iteration is a pair of transitions, RUNNING to PAUSED and back.
+  LatencyHistogram histogram;
+  int64_t total_ns = 0;
+  for (uint64_t i = 0; i < iterations; i++)
+  {
+    const Clock::time_point start = Clock::now();
+    process.setState(RobotProcess::State::PAUSED);
+    const Clock::time_point middle = Clock::now();
+    process.setState(RobotProcess::State::RUNNING);
+    const Clock::time_point end = Clock::now();
+    histogram.record(elapsedNs(start, middle));
+    histogram.record(elapsedNs(middle, end));
+    total_ns += elapsedNs(start, end);
+  }
+  return sampledResult("set_state", histogram, total_ns);
+}
+
+Result benchmarkRun(uint64_t iterations)
+{
+  EmptyProcess process;
+  process.setTransport(quietTransport("/bench_run"));
+  process.setUp();
+  process.start();
+
+  const Clock::time_point start = Clock::now();
+  for (uint64_t i = 0; i < iterations; i++)
+    process.run();
+  const Clock::time_point end = Clock::now();
+  return batchResult("run_empty_own_run", iterations, elapsedNs(start, end));
+}
+
+Result benchmarkServiceRoundTrip(uint64_t iterations)
+{
+  const std::string name = "service_start_stop_round_trip";
+  if (!ros::master::check())
+    return skippedResult(name, "no ROS master");
+
+  EmptyProcess process;
+  process.setUp();
+
+  // Every iteration is a start call followed by a stop call, each waiting for the response.
+  const std::string node = ros::this_node::getName();
+  LatencyHistogram histogram;
+  int64_t total_ns = 0;
+  for (uint64_t i = 0; i < iterations; i++)
+  {
+    std_srvs::Empty start_call, stop_call;
+    const Clock::time_point start = Clock::now();
+    const bool started = ros::service::call(node + "/start", start_call);
+    const Clock::time_point middle = Clock::now();
+    const bool stopped = ros::service::call(node + "/stop", stop_call);
+    const Clock::time_point end = Clock::now();
+    if (!started || !stopped)
+      return skippedResult(name, "service call failed");
+    histogram.record(elapsedNs(start, middle));
+    histogram.record(elapsedNs(middle, end));
+    total_ns += elapsedNs(start, end);
+  }
+  return sampledResult(name, histogram, total_ns);
+}
+
+// Times setUp() of a number of processes, each one with the transport returned by 'make_transport'.
+Result benchmarkSetUp(const std::string& name, uint64_t processes,
+                      const std::function<std::shared_ptr<ProcessTransport>(uint64_t)>& make_transport)
+{
+  std::vector<std::unique_ptr<EmptyProcess>> created;
+  for (uint64_t i = 0; i < processes; i++)
+  {
+    created.push_back(std::unique_ptr<EmptyProcess>(new EmptyProcess()));
+    created.back()->setTransport(make_transport(i));
+  }
+
+  LatencyHistogram histogram;
+  const Clock::time_point start = Clock::now();
+  for (uint64_t i = 0; i < processes; i++)
+  {
+    const Clock::time_point set_up_start = Clock::now();
+    created[i]->setUp();
+    histogram.record(elapsedNs(set_up_start, Clock::now()));
+  }
+  const Clock::time_point end = Clock::now();
+  return sampledResult(name, histogram, elapsedNs(start, end));
+}
+
+// setUp() without ROS nor the state board: the cost of the core of the process.
+Result benchmarkSetUpInProcess(uint64_t processes)
+{
+  return benchmarkSetUp("set_up_" + std::to_string(processes) + "_processes_in_process", processes,
+                        [](uint64_t i) { return quietTransport("/bench_set_up_" + std::to_string(i)); });
+}
+
+// setUp() of processes hosted in this node, as robot_process_container does, with the services, topics,
+// parameters and state board of a deployed process.
+Result benchmarkSetUpRos(uint64_t processes)
+{
+  const std::string name = "set_up_" + std::to_string(processes) + "_processes_ros";
+  if (!ros::master::check())
+    return skippedResult(name, "no ROS master");
+
+  return benchmarkSetUp(name, processes, [](uint64_t i) {
+    return std::make_shared<RosTransport>(ros::this_node::getName() + "/set_up_" + std::to_string(i));
+  });
+}
+
+void writeJson(FILE* file, const std::vector<Result>& results)
+{
+  char host[256] = "";
+  gethostname(host, sizeof host - 1);
+
+  fprintf(file, "{\n  \"host\": \"%s\",\n  \"unix_time\": %lld,\n  \"benchmarks\": [", host,
+          static_cast<long long>(time(NULL)));
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const Result& result = results[i];
+    fprintf(file, "%s\n    {\"name\": \"%s\"", i == 0 ? "" : ",", result.name.c_str());
+    if (!result.skipped.empty())
+    {
+      fprintf(file, ", \"skipped\": \"%s\"}", result.skipped.c_str());
+      continue;
+    }
+    fprintf(file, ", \"iterations\": %llu, \"mean_ns\": %.3f", static_cast<unsigned long long>(result.iterations),
+            result.mean_ns);
+    if (result.has_percentiles)
+      fprintf(file, ", \"p50_ns\": %lld, \"p90_ns\": %lld, \"p99_ns\": %lld, \"p999_ns\": %lld, \"max_ns\": %lld",
+              static_cast<long long>(result.percentiles.p50), static_cast<long long>(result.percentiles.p90),
+              static_cast<long long>(result.percentiles.p99), static_cast<long long>(result.percentiles.p999),
+              static_cast<long long>(result.percentiles.max));
+    fprintf(file, "}");
+  }
+  fprintf(file, "\n  ]\n}\n");
+}
+
+void printUsage(const char* program)
+{
+  fprintf(stderr,
+          "Usage: %s [--iterations N] [--service-iterations N] [--processes N] [--output FILE]\n"
+          "Writes the results in JSON format to FILE, or to the standard output.\n",
+          program);
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "robot_process_bench", ros::init_options::AnonymousName | ros::init_options::NoRosout);
+
+  uint64_t iterations = 1000000;
+  uint64_t service_iterations = 1000;
+  uint64_t processes = 100;
+  const char* output = NULL;
+  for (int i = 1; i < argc; i++)
+  {
+    if (i + 1 < argc && strcmp(argv[i], "--iterations") == 0)
+      iterations = strtoull(argv[++i], NULL, 10);
+    else if (i + 1 < argc && strcmp(argv[i], "--service-iterations") == 0)
+      service_iterations = strtoull(argv[++i], NULL, 10);
+    else if (i + 1 < argc && strcmp(argv[i], "--processes") == 0)
+      processes = strtoull(argv[++i], NULL, 10);
+    else if (i + 1 < argc && strcmp(argv[i], "--output") == 0)
+      output = argv[++i];
+    else
+    {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (iterations == 0 || service_iterations == 0 || processes == 0)
+  {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  std::vector<Result> results;
+  results.push_back(benchmarkGetState(iterations));
+  results.push_back(benchmarkSetState(iterations / 100 + 1));
+  results.push_back(benchmarkRun(iterations));
+  results.push_back(benchmarkServiceRoundTrip(service_iterations));
+  results.push_back(benchmarkSetUpInProcess(processes));
+  results.push_back(benchmarkSetUpRos(processes));
+
+  FILE* file = output != NULL ? fopen(output, "w") : stdout;
+  if (file == NULL)
+  {
+    fprintf(stderr, "Could not open %s\n", output);
+    return 1;
+  }
+  writeJson(file, results);
+  return file != stdout && fclose(file) != 0 ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+/*!*******************************************************************************************
+ *  \file       run_dispatch_benchmark.cpp
+ *  \brief      Benchmark of the dispatch of ownRun().
+ *  \details    This file measures the cost of a cycle of run() with a tiny ownRun() in a
+ *              RobotProcess, which calls it virtually, and in a RobotProcessT, which calls it
+ *              directly.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "robot_process.h"
+#include "robot_process_t.h"
+
+namespace
+{
+const uint64_t DEFAULT_CYCLES = 10000000;
+
+class VirtualProcess : public RobotProcess
+{
+public:
+  uint64_t counter = 0;
+
+protected:
+  void ownSetUp()
+  {
+  }
+  void ownStart()
+  {
+  }
+  void ownStop()
+  {
+  }
+  void ownRun()
+  {
+    counter++;
+  }
+};
+
+class StaticProcess final : public RobotProcessT<StaticProcess>
+{
+  friend class RobotProcessT<StaticProcess>;
+
+public:
+  uint64_t counter = 0;
+
+protected:
+  void ownSetUp()
+  {
+  }
+  void ownStart()
+  {
+  }
+  void ownStop()
+  {
+  }
+  void ownRun()
+  {
+    counter++;
+  }
+};
+
+// Takes the process to RUNNING state without setUp(), which would need a ROS master.
+void startProcess(RobotProcess& process)
+{
+  process.setState(RobotProcess::State::READY_TO_START);
+  process.setState(RobotProcess::State::STARTING);
+  process.setState(RobotProcess::State::RUNNING);
+}
+
+// Returns the mean duration in ns of a call to run().
+template <class Process>
+double measureRun(Process& process, const uint64_t& counter, uint64_t cycles)
+{
+  startProcess(process);
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < cycles; i++)
+    process.run();
+  const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  if (counter != cycles)
+    fprintf(stderr, "ownRun() was called %llu times instead of %llu\n",
+            static_cast<unsigned long long>(counter), static_cast<unsigned long long>(cycles));
+  return std::chrono::duration<double, std::nano>(end - start).count() / cycles;
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "robot_process_dispatch_benchmark",
+            ros::init_options::AnonymousName | ros::init_options::NoRosout);
+  const uint64_t cycles = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_CYCLES;
+
+  // The virtual process is used through the base class, as the loops of the nodes do.
+  VirtualProcess virtual_process;
+  StaticProcess static_process;
+  const double virtual_ns = measureRun<RobotProcess>(virtual_process, virtual_process.counter, cycles);
+  const double static_ns = measureRun(static_process, static_process.counter, cycles);
+
+  printf("cycles:                %llu\n", static_cast<unsigned long long>(cycles));
+  printf("RobotProcess::run():   %.2f ns/cycle\n", virtual_ns);
+  printf("RobotProcessT::run():  %.2f ns/cycle\n", static_ns);
+  printf("At 1 kHz the difference is %.4f%% of the period\n", (virtual_ns - static_ns) * 100 / 1000000.0);
+  return 0;
+}
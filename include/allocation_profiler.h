@@ -0,0 +1,154 @@
+/*!*******************************************************************************************
+ *  \file       allocation_profiler.h
+ *  \brief      AllocationProfiler definition file.
+ *  \details    This file contains the AllocationProfiler declaration and the allocation phase
+ *              macros. To obtain more information about it's definition consult the
+ *              allocation_profiler.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef ALLOCATION_PROFILER
+#define ALLOCATION_PROFILER
+
+#include <stddef.h>
+#include <stdint.h>
+
+//! Part of the life of a process to which the allocations of a thread are attributed.
+enum class AllocationPhase : uint8_t
+{
+  OTHER = 0,
+  SET_UP = 1,
+  START = 2,
+  RUN = 3,
+  CALLBACK = 4
+};
+
+/*!********************************************************************************************************************
+ *  \class      AllocationProfiler
+ *  \brief      Counts the memory allocations of the process per AllocationPhase.
+ *  \details    The allocations are only counted if the library is built with the CMake option
+ *              ROBOT_PROCESS_ALLOC_PROFILER, which replaces the global operator new and operator delete. Otherwise the
+ *              phase scopes compile to nothing and the statistics stay at zero. The definition is exported to the
+ *              packages that depend on robot_process, so this header is the same in all of them. In strict mode the
+ *              first allocation inside ownRun() after the warm-up cycles writes a backtrace to the standard error, or
+ *              aborts the process, so a node that allocates in its real-time path is detected.
+ *
+ *********************************************************************************************************************/
+class AllocationProfiler
+{
+public:
+  static const int PHASE_COUNT = 5;
+
+  //! Action taken on allocations inside ownRun() after the warm-up.
+  enum class StrictMode : uint8_t
+  {
+    OFF = 0,
+    LOG = 1,
+    ABORT = 2
+  };
+
+  //! Allocations attributed to a phase.
+  struct PhaseStatistics
+  {
+    uint64_t allocations;    //!< Calls to operator new.
+    uint64_t bytes;          //!< Bytes requested to operator new.
+    uint64_t deallocations;  //!< Calls to operator delete with a non null pointer.
+  };
+
+  //! Returns true if the library was built with the allocation profiler.
+  static bool isAvailable();
+
+  //! Configures the strict mode, which starts after 'warmup_cycles' calls to countRunCycle().
+  static void setStrictMode(StrictMode mode, uint64_t warmup_cycles);
+
+  //! Counts a cycle of ownRun() for the warm-up of the strict mode.
+  static void countRunCycle();
+
+  //! Returns the allocations of a phase since the process started.
+  static PhaseStatistics getStatistics(AllocationPhase phase);
+
+  //! Returns the name of a phase.
+  static const char* phaseName(AllocationPhase phase);
+
+  //! Phase of the calling thread.
+  static AllocationPhase currentPhase();
+
+  //! Changes the phase of the calling thread and returns the previous one.
+  static AllocationPhase exchangePhase(AllocationPhase phase);
+
+  //! Called by the replaced operator new.
+  static void recordAllocation(size_t bytes);
+
+  //! Called by the replaced operator delete.
+  static void recordDeallocation();
+};
+
+/*!********************************************************************************************************************
+ *  \class      AllocationPhaseScope
+ *  \brief      Attributes the allocations of the calling thread to a phase during the lifetime of the object.
+ *
+ *********************************************************************************************************************/
+class AllocationPhaseScope
+{
+#ifdef ROBOT_PROCESS_ALLOC_PROFILER
+private:
+  AllocationPhase previous;  //!< Phase restored by the destructor.
+
+public:
+  explicit AllocationPhaseScope(AllocationPhase phase) : previous(AllocationProfiler::exchangePhase(phase))
+  {
+  }
+
+  ~AllocationPhaseScope()
+  {
+    AllocationProfiler::exchangePhase(previous);
+  }
+#else
+public:
+  explicit AllocationPhaseScope(AllocationPhase)
+  {
+  }
+#endif
+
+  AllocationPhaseScope(const AllocationPhaseScope&) = delete;
+  AllocationPhaseScope& operator=(const AllocationPhaseScope&) = delete;
+};
+
+#define ROBOT_PROCESS_ALLOCATION_CONCAT_IMPL(a, b) a##b
+#define ROBOT_PROCESS_ALLOCATION_CONCAT(a, b) ROBOT_PROCESS_ALLOCATION_CONCAT_IMPL(a, b)
+
+//! Attributes the allocations of the rest of the enclosing scope to an AllocationPhase.
+#define ROBOT_PROCESS_ALLOCATION_PHASE(phase)                                                                          \
+  AllocationPhaseScope ROBOT_PROCESS_ALLOCATION_CONCAT(allocation_phase_, __LINE__)(AllocationPhase::phase)
+
+#endif
@@ -0,0 +1,187 @@
+/*!*******************************************************************************************
+ *  \file       cycle_arena.h
+ *  \brief      CycleArena definition file.
+ *  \details    This file contains the CycleArena declaration and the ArenaAllocator adaptor. To
+ *              obtain more information about it's definition consult the cycle_arena.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef CYCLE_ARENA
+#define CYCLE_ARENA
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/*!********************************************************************************************************************
+ *  \class      CycleArena
+ *  \brief      Monotonic memory arena for the scratch data of a cycle of ownRun().
+ *  \details    Allocating is a pointer bump and deallocating does nothing; reset() frees everything at once. When the
+ *              reserved memory is exhausted a new chunk is taken from the heap, and it is kept by reset(), so after a
+ *              few cycles the arena stops allocating from the heap. The arena must only be used by one thread at a
+ *              time. The most bytes used in a cycle are kept as a high-water mark that can be read from any thread.
+ *
+ *********************************************************************************************************************/
+class CycleArena
+{
+private:
+  //! Block of memory taken from the heap.
+  struct Chunk
+  {
+    char* memory;
+    size_t size;
+  };
+
+  std::vector<Chunk> chunks;             //!< Chunks of the arena, in the order they are used.
+  size_t current_chunk;                  //!< Chunk in which the next allocation is tried.
+  char* position;                        //!< First free byte of the current chunk.
+  char* limit;                           //!< End of the current chunk.
+  size_t used_before_chunk;              //!< Bytes used in the chunks before the current one.
+  std::atomic<size_t> capacity;          //!< Sum of the sizes of the chunks.
+  std::atomic<size_t> high_water;        //!< Most bytes used in a cycle since the last takeHighWater().
+  std::atomic<size_t> total_high_water;  //!< Most bytes used in a cycle since the arena was created.
+
+public:
+  //! Constructor. The arena reserves no memory until reserve() or allocate() are called.
+  CycleArena();
+
+  //! Releases the memory of the arena.
+  ~CycleArena();
+
+  //! Reserves a first chunk of 'bytes' bytes. It must be called before the arena is used.
+  void reserve(size_t bytes);
+
+  /*!******************************************************************************************************************
+   * \brief Returns 'bytes' bytes of memory aligned to 'alignment', which must be a power of two.
+   * \details The memory is valid until the next reset().
+   *******************************************************************************************************************/
+  void* allocate(size_t bytes, size_t alignment = alignof(max_align_t))
+  {
+    char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(position) + alignment - 1) &
+                                            ~static_cast<uintptr_t>(alignment - 1));
+    if (aligned + bytes > limit || aligned < position)
+      return allocateFromNextChunk(bytes, alignment);
+    position = aligned + bytes;
+    return aligned;
+  }
+
+  //! Frees every allocation of the arena and updates the high-water mark.
+  void reset();
+
+  //! Returns the bytes used since the last reset(), including alignment padding.
+  size_t used() const;
+
+  //! Returns the bytes reserved by the arena. Thread safe.
+  size_t getCapacity() const
+  {
+    return capacity.load(std::memory_order_relaxed);
+  }
+
+  //! Returns the most bytes used in a cycle since the arena was created. Thread safe.
+  size_t getHighWater() const
+  {
+    return total_high_water.load(std::memory_order_relaxed);
+  }
+
+  //! Returns the most bytes used in a cycle since the previous call, and starts a new period. Thread safe.
+  size_t takeHighWater()
+  {
+    return high_water.exchange(0, std::memory_order_relaxed);
+  }
+
+  CycleArena(const CycleArena&) = delete;
+  CycleArena& operator=(const CycleArena&) = delete;
+
+private:
+  //! Moves to the next chunk that can hold the allocation, taking a new one from the heap if there is none.
+  void* allocateFromNextChunk(size_t bytes, size_t alignment);
+
+  //! Makes 'index' the current chunk.
+  void useChunk(size_t index);
+};
+
+/*!********************************************************************************************************************
+ *  \class      ArenaAllocator
+ *  \brief      Allocator of the standard containers that takes its memory from a CycleArena.
+ *  \details    Containers using it must be destroyed, or at least not used, after the arena is reset.
+ *
+ *********************************************************************************************************************/
+template <class T>
+class ArenaAllocator
+{
+private:
+  CycleArena* arena;  //!< Arena from which the memory is taken.
+
+  template <class U>
+  friend class ArenaAllocator;
+
+public:
+  typedef T value_type;
+
+  explicit ArenaAllocator(CycleArena& cycle_arena) : arena(&cycle_arena)
+  {
+  }
+
+  template <class U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena)
+  {
+  }
+
+  T* allocate(size_t count)
+  {
+    return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T*, size_t)
+  {
+  }
+
+  template <class U>
+  bool operator==(const ArenaAllocator<U>& other) const
+  {
+    return arena == other.arena;
+  }
+
+  template <class U>
+  bool operator!=(const ArenaAllocator<U>& other) const
+  {
+    return arena != other.arena;
+  }
+};
+
+//! Vector whose memory is taken from a CycleArena.
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
@@ -0,0 +1,155 @@
+/*!*******************************************************************************************
+ *  \file       in_process_transport.h
+ *  \brief      InProcessTransport definition file.
+ *  \details    This file contains the InProcessTransport declaration. To obtain more information
+ *              about it's definition consult the in_process_transport.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef IN_PROCESS_TRANSPORT
+#define IN_PROCESS_TRANSPORT
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+
+#include "process_transport.h"
+
+/*!********************************************************************************************************************
+ *  \class      InProcessTransport
+ *  \brief      ProcessTransport that needs neither a ROS master nor sockets.
+ *  \details    The parameters are set with setParam() before setUp(), the requests are made by calling the request*
+ *              functions, which call the process directly in the calling thread, and the publications are delivered
+ *              to the listeners, also directly, in the thread of the process that publishes them. It is meant for
+ *              tests, benchmarks and tools that embed processes. The loops of the process run until
+ *              requestShutdown() is called. ros::init() is not needed.
+ *
+ *********************************************************************************************************************/
+class InProcessTransport : public ProcessTransport
+{
+private:
+  std::string name;  //!< Name of the process.
+
+  std::map<std::string, bool> bool_params;                //!< Parameters of type bool.
+  std::map<std::string, int> int_params;                  //!< Parameters of type int.
+  std::map<std::string, double> double_params;            //!< Parameters of type double.
+  std::map<std::string, std::string> string_params;       //!< Parameters of type string.
+  std::map<std::string, std::vector<int>> vector_params;  //!< Parameters of type list of int.
+
+  std::mutex mutex;                            //!< Protects the handlers and the requests.
+  std::condition_variable condition;           //!< Wakes up spin() on shutdown.
+  std::condition_variable requests_condition;  //!< Wakes up shutdown() when the last request finishes.
+  ProcessRequestHandlers handlers;             //!< Functions of the process, empty until advertise().
+  bool serving;                                //!< True between startServing() and shutdown().
+  unsigned int active_requests;                //!< Requests being executed.
+  std::atomic<bool> shut_down;                 //!< True after requestShutdown().
+
+  std::function<void(const ProcessStateChange&)> state_change_listener;  //!< Receives the transitions.
+  std::function<void(const ProcessHeartbeatInfo&)> heartbeat_listener;   //!< Receives the heartbeats.
+  std::function<void(const ProcessMetrics&)> metrics_listener;           //!< Receives the metrics.
+
+public:
+  //! Constructor. 'process_name' is used as the name of the process.
+  explicit InProcessTransport(const std::string& process_name);
+
+  //! Sets a parameter of the process. Parameters are read in setUp().
+  void setParam(const std::string& param_name, bool value);
+  void setParam(const std::string& param_name, int value);
+  void setParam(const std::string& param_name, double value);
+  void setParam(const std::string& param_name, const std::string& value);
+  void setParam(const std::string& param_name, const char* value);
+  void setParam(const std::string& param_name, const std::vector<int>& value);
+
+  //! Sets the functions that receive the publications. They must be set before setUp().
+  void setStateChangeListener(const std::function<void(const ProcessStateChange&)>& listener);
+  void setHeartbeatListener(const std::function<void(const ProcessHeartbeatInfo&)>& listener);
+  void setMetricsListener(const std::function<void(const ProcessMetrics&)>& listener);
+
+  //! Requests the process to start, as the start service. Returns false if it was rejected or is not served.
+  bool requestStart();
+
+  //! Requests the process to stop, as the stop service. Returns false if it was rejected or is not served.
+  bool requestStop();
+
+  //! Requests the process to pause, as the pause service. Returns false if it was rejected or is not served.
+  bool requestPause();
+
+  //! Requests the process to resume, as the resume service. Returns false if it was rejected or is not served.
+  bool requestResume();
+
+  //! Requests the process to write its trace. Returns false if it failed or is not served.
+  bool requestDumpTrace();
+
+  //! Returns the status of the process, with CREATED state if it is not served.
+  ProcessStatus requestStatus();
+
+  //! Makes ok() false, so the loops of the process finish, and wakes up spin().
+  void requestShutdown();
+
+  std::string processName() const;
+
+  void param(const std::string& param_name, bool& value, bool default_value);
+  void param(const std::string& param_name, int& value, int default_value);
+  void param(const std::string& param_name, double& value, double default_value);
+  void param(const std::string& param_name, std::string& value, const std::string& default_value);
+  void param(const std::string& param_name, std::vector<int>& value, const std::vector<int>& default_value);
+
+  void advertise(const ProcessRequestHandlers& process_handlers);
+  void startServing(int);
+
+  //! Stops serving the requests and waits for the ones being executed. It must not be called from a request.
+  void shutdown();
+
+  void publishStateChange(const ProcessStateChange& change);
+  void publishHeartbeat(const ProcessHeartbeatInfo& heartbeat);
+  void publishMetrics(const ProcessMetrics& metrics);
+
+  bool ok() const;
+  void spinOnce();
+  void spin();
+
+private:
+  /*!******************************************************************************************************************
+   * \brief Calls the handler selected by 'member' if the requests are served.
+   * \details The call is counted as an active request until it returns, so shutdown() waits for it.
+   * \return Result of the handler, 'not_served' if the requests are not served.
+   *******************************************************************************************************************/
+  template <class Result>
+  Result callHandler(std::function<Result()> ProcessRequestHandlers::*member, const Result& not_served);
+
+  //! Ends an active request and wakes up shutdown() if it was the last one.
+  void finishRequest();
+};
+#endif
@@ -0,0 +1,125 @@
+/*!*******************************************************************************************
+ *  \file       latency_histogram.h
+ *  \brief      LatencyHistogram definition file.
+ *  \details    This file contains the LatencyHistogram declaration. To obtain more information
+ *              about it's definition consult the latency_histogram.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef LATENCY_HISTOGRAM
+#define LATENCY_HISTOGRAM
+
+#include <atomic>
+#include <stdint.h>
+
+/*!********************************************************************************************************************
+ *  \class      LatencyHistogram
+ *  \brief      Fixed size log-linear histogram of durations in nanoseconds.
+ *  \details    Every power of two is divided in SUB_BUCKET_COUNT linear buckets, like an HDR histogram, so any
+ *              recorded value is represented with a relative error below 1 / SUB_BUCKET_COUNT. Durations longer
+ *              than 2^MAX_VALUE_BITS ns are counted in the last bucket. The histogram never allocates memory and
+ *              record() is wait-free, so it can be used in the hot path while other threads take snapshots.
+ *
+ *********************************************************************************************************************/
+class LatencyHistogram
+{
+public:
+  static const uint32_t SUB_BUCKET_BITS = 5;                       //!< Precision of the buckets.
+  static const uint32_t SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;  //!< Buckets of every power of two.
+  static const uint32_t MAX_VALUE_BITS = 37;                       //!< Values up to 2^37 ns (137 s).
+  static const uint32_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+  //! Percentiles of the values recorded between two snapshots.
+  struct Snapshot
+  {
+    uint64_t count;  //!< Number of values.
+    int64_t p50;     //!< Median.
+    int64_t p90;     //!< 90th percentile.
+    int64_t p99;     //!< 99th percentile.
+    int64_t p999;    //!< 99.9th percentile.
+    int64_t max;     //!< Maximum value.
+  };
+
+private:
+  std::atomic<uint64_t> buckets[BUCKET_COUNT];  //!< Number of values of every bucket since the last snapshot.
+  std::atomic<int64_t> max_value;               //!< Maximum value since the last snapshot.
+  std::atomic<uint64_t> total_count;            //!< Number of values since the histogram was created.
+
+public:
+  //! Constructor.
+  LatencyHistogram();
+
+  //! Adds a duration in nanoseconds to the histogram. It can be called from any thread.
+  void record(int64_t value)
+  {
+    if (value < 0)
+      value = 0;
+    buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    total_count.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t current_max = max_value.load(std::memory_order_relaxed);
+    while (value > current_max &&
+           !max_value.compare_exchange_weak(current_max, value, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  /*!******************************************************************************************************************
+   * \brief Returns the percentiles of the values recorded since the previous snapshot and empties the histogram.
+   * \details Percentiles are reported as the highest value of their bucket, never above the maximum.
+   *******************************************************************************************************************/
+  Snapshot takeSnapshot();
+
+  //! Returns the number of values recorded since the histogram was created.
+  uint64_t totalCount() const
+  {
+    return total_count.load(std::memory_order_relaxed);
+  }
+
+  //! Returns the bucket where a value is counted.
+  static uint32_t bucketIndex(int64_t value)
+  {
+    const uint64_t unsigned_value = static_cast<uint64_t>(value);
+    if (unsigned_value < 2 * SUB_BUCKET_COUNT)
+      return static_cast<uint32_t>(unsigned_value);
+    if (unsigned_value >> MAX_VALUE_BITS)
+      return BUCKET_COUNT - 1;
+
+    const uint32_t shift = 63 - __builtin_clzll(unsigned_value) - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKET_COUNT + static_cast<uint32_t>(unsigned_value >> shift) - SUB_BUCKET_COUNT;
+  }
+
+  //! Returns the highest value counted in a bucket.
+  static int64_t bucketHighestValue(uint32_t index);
+};
+#endif
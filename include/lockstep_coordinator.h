@@ -0,0 +1,114 @@
+/*!*******************************************************************************************
+ *  \file       lockstep_coordinator.h
+ *  \brief      LockstepCoordinator definition file.
+ *  \details    This file contains the LockstepCoordinator declaration. To obtain more information
+ *              about it's definition consult the lockstep_coordinator.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+
+#ifndef LOCKSTEP_COORDINATOR
+#define LOCKSTEP_COORDINATOR
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "process_state_board.h"
+
+/*!********************************************************************************************************************
+ *  \class      LockstepCoordinator
+ *  \brief      Barrier that lets a simulator advance its clock as soon as every process in lockstep has finished.
+ *  \details    The processes of a host that run in lockstep with a RosClock write in the ProcessStateBoard the time
+ *              of every tick they complete, together with their lockstep group, '/clock' unless the parameter
+ *              '~lockstep_group' says otherwise. A coordinator only waits for the processes of its group, so
+ *              processes in lockstep with other clocks never block it. After publishing a time on '/clock', the
+ *              simulator calls waitForTick()
+ *              with that time, which returns when the slowest of those processes has executed its cycle, so the
+ *              simulation is deterministic and no time is spent waiting longer than needed. The board is read with
+ *              plain memory reads: the coordinator spins for a few microseconds and then polls with short sleeps.
+ *              Processes that finish while the simulator waits for them are not waited for.
+ *
+ *********************************************************************************************************************/
+class LockstepCoordinator
+{
+private:
+  std::string hostname;                             //!< Computer whose processes are coordinated.
+  std::string group;                                //!< Lockstep group of the coordinated processes.
+  ProcessStateBoard board;                          //!< Board of the host, mapped when it exists.
+  std::vector<ProcessStateBoard::Entry> entries;    //!< Last copy of the slots of the board.
+
+public:
+  /*!******************************************************************************************************************
+   * \brief Constructor.
+   * \param host           Computer whose processes are coordinated, the local computer if it is empty.
+   * \param lockstep_group Lockstep group of the coordinated processes, the name of their clock.
+   *******************************************************************************************************************/
+  explicit LockstepCoordinator(const std::string& host = "", const std::string& lockstep_group = "/clock");
+
+  //! Returns the number of processes of the host in lockstep in the group.
+  size_t countParticipants();
+
+  /*!******************************************************************************************************************
+   * \brief Waits until at least 'count' processes of the host are in lockstep in the group.
+   * \details It is usually called before the first tick, so no process misses it.
+   * \return False if they are not in lockstep after 'timeout_ns' nanoseconds.
+   *******************************************************************************************************************/
+  bool waitForParticipants(size_t count, int64_t timeout_ns);
+
+  /*!******************************************************************************************************************
+   * \brief Waits until every process of the group has completed the tick at time 'tick_ns'.
+   * \param tick_ns    Time published on '/clock', in nanoseconds. The times of consecutive ticks must increase.
+   * \param timeout_ns Longest real time to wait, in nanoseconds.
+   * \return False if some process has not completed the tick after 'timeout_ns'. pendingParticipants() tells which.
+   *******************************************************************************************************************/
+  bool waitForTick(int64_t tick_ns, int64_t timeout_ns);
+
+  //! Returns the names of the processes of the group that have not completed the tick at time 'tick_ns'.
+  std::vector<std::string> pendingParticipants(int64_t tick_ns);
+
+private:
+  //! Reads the board, mapping it first if needed. Returns false if it does not exist.
+  bool readBoard();
+
+  //! Returns true if every process of the group read from the board has completed the tick at time 'tick_ns'.
+  bool tickCompleted(int64_t tick_ns) const;
+
+  //! Returns true if the process of the entry is in lockstep in the group.
+  bool participates(const ProcessStateBoard::Entry& entry) const;
+
+  //! Reads the board until 'condition' is true or 'timeout_ns' passes. Returns the last value of 'condition'.
+  bool waitFor(const std::function<bool()>& condition, int64_t timeout_ns);
+};
+#endif
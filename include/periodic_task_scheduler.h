@@ -0,0 +1,158 @@
+/*!*******************************************************************************************
+ *  \file       periodic_task_scheduler.h
+ *  \brief      PeriodicTaskScheduler definition file.
+ *  \details    This file contains the PeriodicTaskScheduler declaration. To obtain more
+ *              information about it's definition consult the periodic_task_scheduler.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef PERIODIC_TASK_SCHEDULER
+#define PERIODIC_TASK_SCHEDULER
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include "process_clock.h"
+
+/*!********************************************************************************************************************
+ *  \class      PeriodicTaskScheduler
+ *  \brief      Executes a set of periodic tasks with different rates on a pool of threads.
+ *  \details    Every time a thread is free it executes, among the tasks whose release time has arrived, the one
+ *              with the highest priority. Tasks with the same priority are ordered by rate, so with the default
+ *              priorities the scheduling is rate-monotonic. Scheduling is not preemptive: a long task keeps its
+ *              thread until it finishes, so heavy slow tasks should be given their own thread by starting the
+ *              scheduler with more threads than heavy tasks. A task is never executed by two threads at the same
+ *              time, and when it finishes after its next release the missed periods are skipped and counted as
+ *              overruns.
+ *              The releases are scheduled with a ProcessClock, so with a simulated clock the tasks follow the
+ *              simulated time. The durations of the executions are always measured in real time.
+ *
+ *********************************************************************************************************************/
+class PeriodicTaskScheduler
+{
+public:
+  typedef uint32_t TaskId;                       //!< Identifier of a task, in order of addition.
+  static const TaskId INVALID_TASK = 0xFFFFFFFF;  //!< Returned by addTask() when the task is rejected.
+
+  //! Timing statistics of a task.
+  struct TaskStatistics
+  {
+    std::string name;          //!< Name of the task.
+    double rate;               //!< Frequency of the task in Hz.
+    int priority;              //!< Priority of the task.
+    uint64_t runs;             //!< Number of executions.
+    uint64_t overruns;         //!< Periods skipped because an execution finished after the next release.
+    int64_t last_duration_ns;  //!< Duration of the last execution.
+    int64_t max_duration_ns;   //!< Longest execution.
+    int64_t mean_duration_ns;  //!< Mean duration of the executions.
+  };
+
+private:
+  struct Task
+  {
+    TaskStatistics statistics;        //!< Configuration and statistics of the task.
+    int64_t period_ns;                //!< Period of the task.
+    std::function<void()> function;   //!< Function executed every period.
+    int64_t next_release_ns;          //!< Time of the clock of the next execution.
+    int64_t total_duration_ns;        //!< Sum of the durations of the executions.
+    bool running;                     //!< True while a thread is executing the task.
+  };
+
+  std::vector<std::unique_ptr<Task>> tasks;  //!< Tasks in order of addition.
+  std::vector<std::thread> workers;          //!< Threads executing the tasks.
+  mutable std::mutex mutex;                  //!< Protects the tasks and the flags.
+  std::condition_variable condition;         //!< Wakes up the workers.
+  std::condition_variable idle_condition;    //!< Wakes up waitForIdle() when a task finishes.
+  unsigned int running_tasks;                //!< Number of tasks being executed.
+  bool active;                               //!< Keeps the workers alive while true.
+  bool enabled;                              //!< Tasks are only executed while true.
+  std::shared_ptr<ProcessClock> clock;       //!< Clock of the releases.
+  ProcessClock::ListenerId clock_listener;   //!< Wakes up the workers when a simulated clock advances.
+
+public:
+  //! Constructor.
+  PeriodicTaskScheduler();
+
+  //! Stops the workers.
+  ~PeriodicTaskScheduler();
+
+  /*!******************************************************************************************************************
+   * \brief Adds a task to the scheduler. Tasks must be added before start().
+   * \param name     Name of the task, used in the statistics and the trace.
+   * \param rate     Frequency of the task in Hz.
+   * \param function Function executed every period.
+   * \param priority Priority of the task, higher values are executed first. Tasks with the same priority are ordered
+   * by rate.
+   * \return Identifier of the task, INVALID_TASK if the rate is not positive.
+   *******************************************************************************************************************/
+  TaskId addTask(const std::string& name, double rate, const std::function<void()>& function, int priority);
+
+  //! Returns true if there are tasks to execute.
+  bool hasTasks() const;
+
+  //! Sets the clock of the releases, a RealClock by default. It must be called before start().
+  void setClock(const std::shared_ptr<ProcessClock>& task_clock);
+
+  //! Starts the threads executing the tasks. Tasks are not executed until setEnabled(true) is called.
+  void start(unsigned int threads);
+
+  //! Stops and joins the threads. Tasks being executed are finished first.
+  void stop();
+
+  /*!******************************************************************************************************************
+   * \brief Enables or disables the execution of the tasks. When enabled, every task is released immediately.
+   * \details Disabling does not wait for the tasks being executed, call waitForIdle() for that.
+   *******************************************************************************************************************/
+  void setEnabled(bool enable);
+
+  /*!******************************************************************************************************************
+   * \brief Waits until no task is being executed. It is meant to be called after setEnabled(false), so that no new
+   * execution starts while waiting.
+   * \details When it is called from a task of this scheduler, that task is not waited for.
+   *******************************************************************************************************************/
+  void waitForIdle();
+
+  //! Returns the statistics of every task, in order of addition.
+  std::vector<TaskStatistics> getStatistics() const;
+
+private:
+  //! Loop of the threads executing the tasks.
+  void worker();
+};
+#endif
@@ -0,0 +1,416 @@
+/*!*******************************************************************************************
+ *  \file       process_chain.h
+ *  \brief      ProcessChain definition file.
+ *  \details    This file contains the ProcessChain, ChainInput and ChainOutput declarations. To
+ *              obtain more information about it's definition consult the process_chain.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef PROCESS_CHAIN
+#define PROCESS_CHAIN
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <ros/ros.h>
+
+#include "robot_process.h"
+
+class RunExecutor;
+
+/*!********************************************************************************************************************
+ *  \class      ChainPort
+ *  \brief      Topic of a process that a ProcessChain can hand over in place.
+ *  \details    Ports are registered with the process that owns them by their setUp(), in ownSetUp(), so a chain can
+ *              find the outputs and inputs of its stages with the same topic and message type before the stages
+ *              start. They must be members of the process, so they live as long as it does.
+ *
+ *********************************************************************************************************************/
+class ChainPort
+{
+private:
+  const RobotProcess* owner;   //!< Process that owns the port, nullptr until it is registered.
+  std::string topic;           //!< Resolved name of the topic.
+  const std::type_info* type;  //!< Type of the messages.
+
+  friend class ProcessChain;
+
+public:
+  //! Constructor.
+  ChainPort();
+
+  //! Unregisters the port.
+  virtual ~ChainPort();
+
+  //! Returns the resolved name of the topic, empty until the port is set up.
+  const std::string& getTopic() const
+  {
+    return topic;
+  }
+
+protected:
+  /*!******************************************************************************************************************
+   * \brief Registers the port with its process.
+   * \details The topic is resolved with the node handle of the process when it has a RosTransport, and it is kept as
+   * given otherwise.
+   * \return True if the process has a RosTransport, so the port can be connected to ROS.
+   *******************************************************************************************************************/
+  bool registerPort(RobotProcess& process, const std::string& port_topic, const std::type_info& message_type);
+
+  //! Returns the node handle of a process with a RosTransport, the one of RobotProcess::getNodeHandle().
+  static ros::NodeHandle nodeHandle(RobotProcess& process);
+
+private:
+  //! Returns true for outputs.
+  virtual bool isOutput() const = 0;
+
+  //! Hands over the messages of this output to 'input' in place. It is only called with ports of the same type.
+  virtual void fuse(ChainPort&)
+  {
+  }
+
+  //! Undoes fuse().
+  virtual void unfuse(ChainPort&)
+  {
+  }
+
+  //! Stops or restarts the ROS subscription of an input fused to an output, restarting it only if subscribed.
+  virtual void setFused(bool)
+  {
+  }
+
+  //! Returns the ports registered by 'process'.
+  static std::vector<ChainPort*> portsOf(const RobotProcess& process);
+
+  ChainPort(const ChainPort&) = delete;
+  ChainPort& operator=(const ChainPort&) = delete;
+};
+
+/*!********************************************************************************************************************
+ *  \class      ChainInput
+ *  \brief      Subscription of a process whose messages can be handed over in place by a ProcessChain.
+ *  \details    The input is registered with its process in ownSetUp(), so a chain can fuse it before the process
+ *              starts, and it receives messages between subscribe() and shutdown(), which are called from ownStart()
+ *              and ownStop() as for a plain subscriber. While the input is not fused, it is a ROS subscriber, served
+ *              as the other callbacks of the process, that keeps the last message received. When a ProcessChain
+ *              fuses it to the output of a previous stage, the subscriber is shut down and the output stores its
+ *              messages directly, in the thread of the chain, just before the run() of this stage. Messages that
+ *              arrive while the input is shut down are discarded. ownRun() reads it the same way in both cases:
+ *              \code
+ *              ChainInput<sensor_msgs::Imu> imu;  // member of the process
+ *              ...
+ *              imu.setUp(*this, "imu", 1);        // in ownSetUp()
+ *              imu.subscribe();                   // in ownStart()
+ *              imu.shutdown();                    // in ownStop()
+ *              ...
+ *              sensor_msgs::Imu::ConstPtr message = imu.take();  // in ownRun()
+ *              if (message)
+ *                filter(*message);
+ *              \endcode
+ *
+ *********************************************************************************************************************/
+template <class Message>
+class ChainInput : public ChainPort
+{
+public:
+  typedef boost::shared_ptr<Message const> MessagePtr;
+
+private:
+  std::mutex mutex;                         //!< Protects the messages, received from the callbacks or the chain.
+  MessagePtr latest_message;                //!< Last message received.
+  bool fresh;                               //!< True if the last message has not been taken.
+  bool active;                              //!< Messages are only received between subscribe() and shutdown().
+  std::mutex connection_mutex;              //!< Protects the subscription, changed by the process and the chain.
+  bool subscribed;                          //!< True between subscribe() and shutdown().
+  bool fused;                               //!< True while a ProcessChain hands the messages over in place.
+  std::unique_ptr<ros::NodeHandle> handle;  //!< Node handle of the process, nullptr without a RosTransport.
+  std::string subscribed_topic;             //!< Topic as given to setUp(), resolved by the node handle.
+  uint32_t queue_size;                      //!< Queue size of the subscription.
+  ros::Subscriber subscriber;               //!< ROS subscription, only while subscribed and not fused.
+
+public:
+  ChainInput() : fresh(false), active(false), subscribed(false), fused(false), queue_size(1)
+  {
+  }
+
+  /*!******************************************************************************************************************
+   * \brief Registers the input for 'topic', resolved in the namespace of 'process'. It must be called from ownSetUp().
+   * \details Without a RosTransport, as with an InProcessTransport in tests, the input only receives the messages of
+   * the outputs it is fused to.
+   *******************************************************************************************************************/
+  void setUp(RobotProcess& process, const std::string& port_topic, uint32_t subscriber_queue_size)
+  {
+    std::lock_guard<std::mutex> lock(connection_mutex);
+    subscribed_topic = port_topic;
+    queue_size = subscriber_queue_size;
+    if (registerPort(process, port_topic, typeid(Message)))
+      handle.reset(new ros::NodeHandle(nodeHandle(process)));
+  }
+
+  //! Starts receiving messages, from ROS unless the input is fused. It must be called from ownStart().
+  void subscribe()
+  {
+    std::lock_guard<std::mutex> lock(connection_mutex);
+    {
+      std::lock_guard<std::mutex> messages_lock(mutex);
+      active = true;
+    }
+    subscribed = true;
+    connect();
+  }
+
+  //! Stops receiving messages and discards the last one. It must be called from ownStop().
+  void shutdown()
+  {
+    std::lock_guard<std::mutex> lock(connection_mutex);
+    {
+      std::lock_guard<std::mutex> messages_lock(mutex);
+      active = false;
+      latest_message.reset();
+      fresh = false;
+    }
+    subscribed = false;
+    connect();
+  }
+
+  //! Returns the last message if it has not been taken yet, and nullptr otherwise.
+  MessagePtr take()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!fresh)
+      return MessagePtr();
+    fresh = false;
+    return latest_message;
+  }
+
+  //! Returns the last message received, nullptr if there is none.
+  MessagePtr latest()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return latest_message;
+  }
+
+  //! Stores a message as the last one received, unless the input is shut down.
+  void deliver(const MessagePtr& message)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!active)
+      return;
+    latest_message = message;
+    fresh = true;
+  }
+
+private:
+  bool isOutput() const
+  {
+    return false;
+  }
+
+  void setFused(bool fuse_input)
+  {
+    std::lock_guard<std::mutex> lock(connection_mutex);
+    fused = fuse_input;
+    connect();
+  }
+
+  //! Subscribes to ROS if the input is subscribed, not fused and has a node handle, and unsubscribes otherwise.
+  void connect()
+  {
+    subscriber.shutdown();
+    if (subscribed && !fused && handle)
+      subscriber = handle->subscribe(subscribed_topic, queue_size, &ChainInput::deliver, this,
+                                     ros::TransportHints().tcpNoDelay());
+  }
+};
+
+/*!********************************************************************************************************************
+ *  \class      ChainOutput
+ *  \brief      Publisher of a process whose messages can be handed over in place by a ProcessChain.
+ *  \details    The output is registered with its process in ownSetUp(), and it is advertised on ROS between
+ *              advertise() and shutdown(), which are called from ownStart() and ownStop(). While the output is not
+ *              fused, publish() publishes the message on ROS. When a ProcessChain fuses it to the inputs of the next
+ *              stages, the pointer is stored in those inputs instead, and the message is only published on ROS if
+ *              other nodes subscribe to it. Either way the message must not be modified after being published.
+ *
+ *********************************************************************************************************************/
+template <class Message>
+class ChainOutput : public ChainPort
+{
+public:
+  typedef boost::shared_ptr<Message const> MessagePtr;
+
+private:
+  std::unique_ptr<ros::NodeHandle> handle;         //!< Node handle of the process, nullptr without a RosTransport.
+  std::string advertised_topic;                    //!< Topic as given to setUp(), resolved by the node handle.
+  uint32_t queue_size;                             //!< Queue size of the publisher.
+  bool latch;                                      //!< True if the publisher is latched.
+  ros::Publisher publisher;                        //!< ROS publisher between advertise() and shutdown().
+  std::vector<ChainInput<Message>*> fused_inputs;  //!< Inputs receiving the messages in place.
+
+public:
+  ChainOutput() : queue_size(1), latch(false)
+  {
+  }
+
+  //! Registers the output for 'topic', resolved in the namespace of 'process'. It must be called from ownSetUp().
+  void setUp(RobotProcess& process, const std::string& port_topic, uint32_t publisher_queue_size,
+             bool latch_messages = false)
+  {
+    advertised_topic = port_topic;
+    queue_size = publisher_queue_size;
+    latch = latch_messages;
+    if (registerPort(process, port_topic, typeid(Message)))
+      handle.reset(new ros::NodeHandle(nodeHandle(process)));
+  }
+
+  //! Advertises the topic on ROS, if the process has a RosTransport. It must be called from ownStart().
+  void advertise()
+  {
+    if (handle)
+      publisher = handle->advertise<Message>(advertised_topic, queue_size, latch);
+  }
+
+  //! Stops publishing on ROS. It must be called from ownStop().
+  void shutdown()
+  {
+    publisher.shutdown();
+  }
+
+  //! Publishes a message, handing it over to the fused inputs.
+  void publish(const MessagePtr& message)
+  {
+    for (ChainInput<Message>* input : fused_inputs)
+      input->deliver(message);
+    if (publisher && (fused_inputs.empty() || publisher.getNumSubscribers() > 0))
+      publisher.publish(message);
+  }
+
+private:
+  bool isOutput() const
+  {
+    return true;
+  }
+
+  void fuse(ChainPort& input)
+  {
+    fused_inputs.push_back(static_cast<ChainInput<Message>*>(&input));
+  }
+
+  void unfuse(ChainPort& input)
+  {
+    for (size_t i = 0; i < fused_inputs.size(); i++)
+    {
+      if (fused_inputs[i] == &input)
+      {
+        fused_inputs.erase(fused_inputs.begin() + i);
+        return;
+      }
+    }
+  }
+};
+
+/*!********************************************************************************************************************
+ *  \class      ProcessChain
+ *  \brief      Executes a pipeline of processes of the same OS process back to back, in one thread.
+ *  \details    The stages of a chain, such as driver, filter, estimator and controller, are executed in the order they
+ *              were added: every run() of the chain serves the callbacks of each stage and calls its run(), so a
+ *              message produced by a stage is consumed by the next ones in the same cycle instead of one period
+ *              later. fuse() connects every ChainOutput of a stage with the ChainInputs of the next stages that have
+ *              the same topic and message type, so those messages are handed over as a pointer, without going
+ *              through ROS. Connections to previous stages, for feedback, keep going through ROS. The stages must not
+ *              be executed by runAtRate(), runOnTriggers() nor other chains.
+ *
+ *********************************************************************************************************************/
+class ProcessChain
+{
+private:
+  std::string name;                                            //!< Name of the chain.
+  std::vector<RobotProcess*> stages;                           //!< Processes in order of execution.
+  std::vector<std::pair<ChainPort*, ChainPort*>> fused_ports;  //!< Fused outputs and inputs.
+
+public:
+  //! Constructor.
+  explicit ProcessChain(const std::string& chain_name);
+
+  //! Unfuses the ports.
+  ~ProcessChain();
+
+  //! Returns the name of the chain.
+  const std::string& getName() const
+  {
+    return name;
+  }
+
+  //! Adds a stage at the end of the chain. The process must have been set up, so its ports are registered.
+  void addStage(RobotProcess& process);
+
+  /*!******************************************************************************************************************
+   * \brief Hands over in place the messages from the outputs of every stage to the inputs of the next ones.
+   * \details It must be called before the chain is executed, with the ports of every stage already registered.
+   * \return Number of fused pairs of ports.
+   *******************************************************************************************************************/
+  size_t fuse();
+
+  //! Connects every fused port to ROS again. It must not be called while the chain is executed.
+  void unfuse();
+
+  //! Serves the callbacks of every stage and calls its run(), in order.
+  void run();
+
+  /*!******************************************************************************************************************
+   * \brief Executes the stages at 'rate' until the transport of the first stage shuts down.
+   * \details The loop is the one of RobotProcess::runAtRate() of the first stage, with its clock, its '~realtime' and
+   * '~lockstep' parameters and its run statistics. The other stages are executed with
+   * RobotProcess::runScheduledCycle() and the release of the cycle, so their run statistics are updated too.
+   *******************************************************************************************************************/
+  void runAtRate(double rate);
+
+  /*!******************************************************************************************************************
+   * \brief Adds the chain to 'executor' as a job executed at 'rate'. The chain must outlive the execution of the job.
+   * \details Every stage is executed with RobotProcess::runScheduledCycle(), so their run statistics are updated as
+   * those of the processes of the executor. The statistics are reset here, so the executor must be started after.
+   *******************************************************************************************************************/
+  uint32_t addTo(RunExecutor& executor, double rate);
+
+private:
+  //! Executes the stages from 'first_stage' on, in a cycle released at 'release_ns'.
+  void runStages(size_t first_stage, int64_t release_ns);
+
+  ProcessChain(const ProcessChain&) = delete;
+  ProcessChain& operator=(const ProcessChain&) = delete;
+};
+#endif
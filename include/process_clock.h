@@ -0,0 +1,199 @@
+/*!*******************************************************************************************
+ *  \file       process_clock.h
+ *  \brief      ProcessClock definition file.
+ *  \details    This file contains the declarations of ProcessClock and of its real and manual
+ *              implementations. To obtain more information about their definition consult the
+ *              process_clock.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+
+#ifndef PROCESS_CLOCK
+#define PROCESS_CLOCK
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+/*!********************************************************************************************************************
+ *  \class      ProcessClock
+ *  \brief      Time source of the loops, periodic tasks, heartbeat and metrics of a RobotProcess.
+ *  \details    Times are expressed in nanoseconds. A RealClock follows CLOCK_MONOTONIC. A simulated clock, as the
+ *              ManualClock and the RosClock, only advances when it is stepped, so a process can run faster or slower
+ *              than real time. Every step of a simulated clock is a tick, and the loops in lockstep with the clock
+ *              execute exactly one cycle per tick.
+ *
+ *********************************************************************************************************************/
+class ProcessClock
+{
+public:
+  typedef uint32_t ListenerId;  //!< Identifier of a function called when the clock advances.
+
+  virtual ~ProcessClock()
+  {
+  }
+
+  //! Returns the current time in nanoseconds. Thread safe.
+  virtual int64_t now() const = 0;
+
+  //! Returns true if the clock only advances when it is stepped.
+  virtual bool isSimulated() const = 0;
+
+  //! Number of periods whose deadline has passed at 'now_ns', where 'deadline_ns' is the deadline of the current one.
+  static int64_t expiredPeriods(int64_t now_ns, int64_t deadline_ns, int64_t period_ns)
+  {
+    return now_ns > deadline_ns ? (now_ns - deadline_ns) / period_ns + 1 : 0;
+  }
+
+  /*!******************************************************************************************************************
+   * \brief Sleeps until the clock reaches 'deadline_ns'.
+   * \return True if the deadline has arrived. Simulated clocks return false when the deadline has not arrived after
+   * 100 ms of real time, so the caller can check if it has to finish and sleep again if not.
+   *******************************************************************************************************************/
+  virtual bool sleepUntil(int64_t deadline_ns) = 0;
+
+  /*!******************************************************************************************************************
+   * \brief Waits on 'condition', whose mutex is held by 'lock', until it is notified or the clock reaches
+   * 'deadline_ns'.
+   * \details It may return earlier, so the caller has to check again what it is waiting for. To be woken up when a
+   * simulated clock advances, the caller must register a listener that notifies 'condition' while holding its mutex.
+   *******************************************************************************************************************/
+  virtual void waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+                         int64_t deadline_ns) = 0;
+
+  /*!******************************************************************************************************************
+   * \brief Registers a function called, in the thread that steps the clock, every time a simulated clock advances.
+   * \details The function must be short and must not call the clock. Real clocks never call it.
+   *******************************************************************************************************************/
+  virtual ListenerId addAdvanceListener(const std::function<void()>& listener) = 0;
+
+  //! Unregisters a listener. When it returns, the listener is not being called and will not be called anymore.
+  virtual void removeAdvanceListener(ListenerId listener) = 0;
+
+  /*!******************************************************************************************************************
+   * \brief Makes the calling loop a participant of the lockstep, so every step of the clock waits for it.
+   * \details Only simulated clocks have ticks.
+   * \return Current tick of the clock. The loop runs its first cycle at the next one.
+   *******************************************************************************************************************/
+  virtual uint64_t joinLockstep() = 0;
+
+  /*!******************************************************************************************************************
+   * \brief Waits until the tick of the clock is newer than 'previous_tick'.
+   * \param tick Current tick of the clock when it returns true.
+   * \return False if there is no new tick after 100 ms of real time.
+   *******************************************************************************************************************/
+  virtual bool waitForTick(uint64_t previous_tick, uint64_t& tick) = 0;
+
+  //! Tells the clock that the calling participant has finished the cycle of 'tick'.
+  virtual void completeTick(uint64_t tick) = 0;
+
+  //! Removes a participant of the lockstep. 'last_tick' is the last tick that it completed or joined at.
+  virtual void leaveLockstep(uint64_t last_tick) = 0;
+};
+
+/*!********************************************************************************************************************
+ *  \class      RealClock
+ *  \brief      ProcessClock that follows CLOCK_MONOTONIC. It is the clock of a RobotProcess unless another one is set.
+ *
+ *********************************************************************************************************************/
+class RealClock : public ProcessClock
+{
+public:
+  int64_t now() const;
+  bool isSimulated() const;
+  bool sleepUntil(int64_t deadline_ns);
+  void waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition, int64_t deadline_ns);
+  ListenerId addAdvanceListener(const std::function<void()>& listener);
+  void removeAdvanceListener(ListenerId listener);
+  uint64_t joinLockstep();
+  bool waitForTick(uint64_t previous_tick, uint64_t& tick);
+  void completeTick(uint64_t tick);
+  void leaveLockstep(uint64_t last_tick);
+};
+
+/*!********************************************************************************************************************
+ *  \class      ManualClock
+ *  \brief      Simulated ProcessClock advanced by calling step() or advanceTo().
+ *  \details    Every call to step() or advanceTo() is a tick. It wakes up the loops, tasks and signals of the processes
+ *              that use the clock and, before returning, waits until every loop in lockstep has executed its cycle of
+ *              the tick. So a mission can be replayed as fast as the processes can execute it, with exactly one
+ *              cycle per tick. The clock must be stepped from a single thread, which must not be the thread of a
+ *              loop in lockstep.
+ *
+ *********************************************************************************************************************/
+class ManualClock : public ProcessClock
+{
+private:
+  std::atomic<int64_t> time_ns;  //!< Current time.
+
+  mutable std::mutex mutex;                   //!< Protects the tick and the lockstep participants.
+  std::condition_variable condition;          //!< Wakes up the sleepers and the loops in lockstep.
+  std::condition_variable tick_condition;     //!< Wakes up the stepping thread when the tick is completed.
+  uint64_t current_tick;                      //!< Number of steps.
+  unsigned int lockstep_participants;         //!< Loops in lockstep with the clock.
+  unsigned int pending_completions;           //!< Participants that have not completed the current tick.
+
+  std::mutex listener_mutex;                                              //!< Protects the listeners.
+  std::vector<std::pair<ListenerId, std::function<void()>>> listeners;  //!< Functions called when time advances.
+  ListenerId next_listener;                                               //!< Identifier of the next listener.
+
+public:
+  //! Constructor. The clock starts at 'start_ns'.
+  explicit ManualClock(int64_t start_ns = 0);
+
+  //! Advances the clock 'duration_ns' and waits until the loops in lockstep have executed the tick.
+  void step(int64_t duration_ns);
+
+  //! Sets the clock to 'new_time_ns', unless it is in the past, and waits until the loops in lockstep have executed
+  //! the tick.
+  void advanceTo(int64_t new_time_ns);
+
+  //! Returns the number of ticks.
+  uint64_t getTick() const;
+
+  int64_t now() const;
+  bool isSimulated() const;
+  bool sleepUntil(int64_t deadline_ns);
+  void waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition, int64_t deadline_ns);
+  ListenerId addAdvanceListener(const std::function<void()>& listener);
+  void removeAdvanceListener(ListenerId listener);
+  uint64_t joinLockstep();
+  bool waitForTick(uint64_t previous_tick, uint64_t& tick);
+  void completeTick(uint64_t tick);
+  void leaveLockstep(uint64_t last_tick);
+};
+#endif
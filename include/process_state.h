@@ -0,0 +1,131 @@
+/*!*********************************************************************************
+ *  \file       process_state.h
+ *  \brief      ProcessState definition file.
+ *  \details    This file contains the states a RobotProcess can be at, their names and the
+ *              table of legal transitions between them. Everything in this file is constexpr,
+ *              so it can be evaluated at compile time.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+#ifndef PROCESS_STATE
+#define PROCESS_STATE
+
+#include <stdint.h>
+
+/*!********************************************************************************************************************
+ *  \enum       ProcessState
+ *  \brief      States a RobotProcess can be at.
+ *  \details    STARTING and STOPPING are the states of a process while its ownStart() or ownStop() is being
+ *              executed. STARTED and NOT_STARTED are kept for the processes that report them with the former
+ *              setState(uint8_t). No transition of the table leads to them, but they can change to the states they
+ *              stand for, RUNNING and READY_TO_START, and to the transitions out of those.
+ *********************************************************************************************************************/
+enum class ProcessState : uint8_t
+{
+  CREATED = 1,
+  READY_TO_START = 2,
+  RUNNING = 3,
+  PAUSED = 4,
+  STARTING = 5,
+  STOPPING = 6,
+
+  STARTED = 7,
+  NOT_STARTED = 8
+};
+
+//! Number of entries of the tables indexed by ProcessState.
+constexpr uint8_t PROCESS_STATE_TABLE_SIZE = 9;
+
+//! Returns the index of a state in the tables indexed by ProcessState.
+constexpr uint8_t processStateIndex(ProcessState state)
+{
+  return static_cast<uint8_t>(state);
+}
+
+//! Returns the bit that represents a state in the transition table.
+constexpr uint16_t processStateBit(ProcessState state)
+{
+  return static_cast<uint16_t>(1u << processStateIndex(state));
+}
+
+//! Names of the states, indexed by ProcessState.
+constexpr const char* PROCESS_STATE_NAMES[PROCESS_STATE_TABLE_SIZE] = {
+  "UNDEFINED", "CREATED", "READY_TO_START", "RUNNING", "PAUSED", "STARTING", "STOPPING", "STARTED", "NOT_STARTED"
+};
+
+//! For every state, bit mask of the states it can legally change to.
+constexpr uint16_t PROCESS_STATE_TRANSITIONS[PROCESS_STATE_TABLE_SIZE] = {
+  // Undefined
+  0,
+  // CREATED
+  processStateBit(ProcessState::READY_TO_START),
+  // READY_TO_START
+  processStateBit(ProcessState::STARTING),
+  // RUNNING
+  processStateBit(ProcessState::STOPPING) | processStateBit(ProcessState::PAUSED),
+  // PAUSED
+  processStateBit(ProcessState::RUNNING) | processStateBit(ProcessState::STOPPING),
+  // STARTING
+  processStateBit(ProcessState::RUNNING),
+  // STOPPING
+  processStateBit(ProcessState::READY_TO_START),
+  // STARTED
+  processStateBit(ProcessState::RUNNING) | processStateBit(ProcessState::STOPPING) |
+      processStateBit(ProcessState::PAUSED),
+  // NOT_STARTED
+  processStateBit(ProcessState::READY_TO_START) | processStateBit(ProcessState::STARTING)
+};
+
+//! Returns the name of a state, or "UNDEFINED" if the value is not a state.
+constexpr const char* processStateName(ProcessState state)
+{
+  return processStateIndex(state) < PROCESS_STATE_TABLE_SIZE ? PROCESS_STATE_NAMES[processStateIndex(state)] :
+                                                               "UNDEFINED";
+}
+
+//! Returns true if a process can change from state 'from' to state 'to'.
+constexpr bool isLegalTransition(ProcessState from, ProcessState to)
+{
+  return processStateIndex(from) < PROCESS_STATE_TABLE_SIZE && processStateIndex(to) < PROCESS_STATE_TABLE_SIZE &&
+         (PROCESS_STATE_TRANSITIONS[processStateIndex(from)] & processStateBit(to)) != 0;
+}
+
+// Former STATE_* macros, kept so existing processes keep compiling.
+constexpr ProcessState STATE_CREATED = ProcessState::CREATED;
+constexpr ProcessState STATE_READY_TO_START = ProcessState::READY_TO_START;
+constexpr ProcessState STATE_RUNNING = ProcessState::RUNNING;
+constexpr ProcessState STATE_PAUSED = ProcessState::PAUSED;
+
+constexpr ProcessState STATE_STARTED = ProcessState::STARTED;
+constexpr ProcessState STATE_NOT_STARTED = ProcessState::NOT_STARTED;
+
+#endif
@@ -0,0 +1,173 @@
+/*!*******************************************************************************************
+ *  \file       process_state_board.h
+ *  \brief      ProcessStateBoard definition file.
+ *  \details    This file contains the ProcessStateBoard declaration. To obtain more information
+ *              about it's definition consult the process_state_board.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef PROCESS_STATE_BOARD
+#define PROCESS_STATE_BOARD
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+#include "process_state.h"
+
+/*!********************************************************************************************************************
+ *  \class      ProcessStateBoard
+ *  \brief      Host-wide board with the state of every RobotProcess running on the computer.
+ *  \details    The board is a POSIX shared memory segment named after the hostname. Every process claims a fixed
+ *              size slot of the segment where it writes its name, state, PID, the time of its last ownRun() and
+ *              its counters. Writes are protected with a sequence lock, so a supervisor can read the state of
+ *              every process of the host with plain memory reads, without system calls nor ROS traffic.
+ *              Processes in lockstep with a clock shared by the host, such as '/clock', also write the name of
+ *              that clock, their lockstep group, and the last tick they have completed, which is the barrier used by
+ *              the LockstepCoordinator.
+ *
+ *********************************************************************************************************************/
+class ProcessStateBoard
+{
+public:
+  static const uint32_t SLOT_COUNT = 128;   //!< Maximum number of processes of a host.
+  static const uint32_t NAME_LENGTH = 96;   //!< Maximum length of a process name, including the terminator.
+  static const uint32_t GROUP_LENGTH = 32;  //!< Maximum length of a lockstep group, including the terminator.
+
+  //! Content of a slot of the board.
+  struct Entry
+  {
+    char name[NAME_LENGTH];             //!< Name of the process.
+    int32_t pid;                        //!< PID of the OS process.
+    ProcessState state;                 //!< Current state of the process.
+    int64_t last_run_ns;                //!< CLOCK_MONOTONIC time at which ownRun() returned the last time.
+    uint64_t run_count;                 //!< Number of ownRun() calls.
+    uint64_t missed_deadlines;          //!< Deadlines missed by runAtRate().
+    uint64_t state_changes;             //!< Number of state transitions.
+    bool lockstep;                      //!< True while runAtRate() executes one cycle per tick of a simulated clock.
+    int64_t completed_tick_ns;          //!< Time of the simulated clock of the last tick completed in lockstep.
+    char lockstep_group[GROUP_LENGTH];  //!< Clock the process is in lockstep with, for the LockstepCoordinator.
+  };
+
+private:
+  struct Slot;
+  struct Segment;
+
+  Segment* segment;                //!< Shared memory segment of the host.
+  Slot* slot;                      //!< Slot claimed by this process.
+  uint32_t token;                  //!< Tells the slot apart from the other slots claimed by this OS process.
+  std::atomic_flag writer_lock;    //!< Serializes the writers of the slot inside this process.
+
+public:
+  //! Constructor.
+  ProcessStateBoard();
+
+  ~ProcessStateBoard();
+
+  /*!******************************************************************************************************************
+   * \brief Opens the board of the host, creating it if needed, and claims a slot for the process.
+   * \details A slot is owned by the PID and a token, so the slots of the processes hosted by a container are told
+   * apart. Slots owned by processes that do not exist anymore are reused, even if they died while writing. The board
+   * is created with read and write permissions for every user.
+   * \param   hostname     Computer on which the process is executing.
+   * \param   process_name Name written in the slot.
+   * \return  False if the board could not be opened or it is full.
+   *******************************************************************************************************************/
+  bool registerProcess(const std::string& hostname, const std::string& process_name);
+
+  //! Releases the slot of the process.
+  void unregisterProcess();
+
+  /*!******************************************************************************************************************
+   * \brief Maps the board of a host to read it with readEntries(), without claiming a slot.
+   * \return False if the board of the host does not exist.
+   *******************************************************************************************************************/
+  bool attach(const std::string& hostname);
+
+  //! Returns true if the board is mapped, either by registerProcess() or by attach().
+  bool isAttached() const
+  {
+    return segment != nullptr;
+  }
+
+  //! Returns true if the process owns a slot of the board.
+  bool isRegistered() const
+  {
+    return slot != nullptr;
+  }
+
+  //! Writes the new state of the process.
+  void updateState(ProcessState state);
+
+  //! Writes the end time of an ownRun() call and the deadlines missed so far.
+  void updateRun(int64_t last_run_ns, uint64_t missed_deadlines);
+
+  //! Writes if the process is in lockstep with the clock 'group' and the time of the last tick it has completed.
+  void updateLockstep(const std::string& group, bool lockstep, int64_t completed_tick_ns);
+
+  //! Reads the occupied slots of the mapped board. Returns false if it is not mapped.
+  bool readEntries(std::vector<Entry>& entries) const;
+
+  /*!******************************************************************************************************************
+   * \brief Reads the slots of every process registered in the board of a host.
+   * \param   hostname Computer whose board is read.
+   * \param   entries  Consistent copy of the occupied slots. Slots left in the middle of a write by a process that
+   *                   died are skipped.
+   * \return  False if the board of the host does not exist.
+   *******************************************************************************************************************/
+  static bool read(const std::string& hostname, std::vector<Entry>& entries);
+
+  //! Returns true if the OS process 'pid' exists, even if it belongs to another user.
+  static bool isAlive(int32_t pid);
+
+private:
+  //! Returns the name of the shared memory segment of a host.
+  static std::string segmentName(const std::string& hostname);
+
+  //! Maps the segment of a host, returns nullptr on failure.
+  static Segment* openSegment(const std::string& hostname, bool create);
+
+  //! Appends to 'entries' a consistent copy of the occupied slots of 'board'.
+  static void readSegment(const Segment* board, std::vector<Entry>& entries);
+
+  //! Forgets the token of the slot, which can be reused by other processes from then on.
+  void releaseToken();
+
+  //! Starts a write of the slot.
+  void beginWrite();
+
+  //! Finishes a write of the slot.
+  void endWrite();
+};
+#endif
@@ -0,0 +1,162 @@
+/*!*******************************************************************************************
+ *  \file       process_transport.h
+ *  \brief      ProcessTransport definition file.
+ *  \details    This file contains the ProcessTransport interface, through which a RobotProcess
+ *              communicates, and the plain structures it exchanges. It is header only.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef PROCESS_TRANSPORT
+#define PROCESS_TRANSPORT
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "process_state.h"
+
+//! State and run statistics of a process, as answered to a status request.
+struct ProcessStatus
+{
+  ProcessState state;            //!< Current state.
+  double uptime;                 //!< Seconds since setUp() was called.
+  uint64_t cycles;               //!< Periods executed by runAtRate().
+  uint64_t missed_deadlines;     //!< Periods skipped by runAtRate().
+  int64_t last_run_duration_ns;  //!< Duration of the last run() call of runAtRate().
+  int64_t max_run_duration_ns;   //!< Longest run() call of runAtRate().
+  int64_t mean_run_duration_ns;  //!< Mean duration of the run() calls of runAtRate().
+  int64_t max_jitter_ns;         //!< Longest wake up delay of runAtRate().
+};
+
+//! Transition between two states of a process.
+struct ProcessStateChange
+{
+  ProcessState previous_state;  //!< State before the transition.
+  ProcessState state;           //!< State after the transition.
+};
+
+//! Periodic signal of life of a process.
+struct ProcessHeartbeatInfo
+{
+  uint64_t seq;          //!< Sequence number, incremented by every heartbeat.
+  std::string hostname;  //!< Computer on which the process is executing.
+  std::string drone_id;  //!< Drone on which the process is executing.
+  ProcessState state;    //!< Current state.
+};
+
+//! Duration percentiles of the ownRun() calls of a metrics period.
+struct ProcessMetrics
+{
+  uint64_t cycles;                  //!< ownRun() calls in the period.
+  uint64_t total_cycles;            //!< ownRun() calls since the process was created.
+  int64_t p50_ns;                   //!< Median duration.
+  int64_t p90_ns;                   //!< 90th percentile of the duration.
+  int64_t p99_ns;                   //!< 99th percentile of the duration.
+  int64_t p999_ns;                  //!< 99.9th percentile of the duration.
+  int64_t max_ns;                   //!< Longest duration.
+  uint64_t arena_high_water_bytes;  //!< Most bytes of the cycle arena used by an ownRun() call in the period.
+  uint64_t arena_capacity_bytes;    //!< Bytes reserved by the cycle arena.
+};
+
+//! Functions of a process that its transport calls when it receives requests.
+struct ProcessRequestHandlers
+{
+  std::function<bool()> start;                //!< Starts the process. Returns false if it was not ready to start.
+  std::function<bool()> stop;                 //!< Stops the process. Returns false if it was not running nor paused.
+  std::function<bool()> pause;                //!< Pauses the process. Returns false if it was not running.
+  std::function<bool()> resume;               //!< Resumes the process. Returns false if it was not paused.
+  std::function<bool()> dump_trace;           //!< Writes the trace. Returns false if it could not be written.
+  std::function<ProcessStatus()> get_status;  //!< Returns the status. It must not wait for the lifecycle.
+  std::function<ProcessState()> get_state;    //!< Returns the state with a single atomic load.
+};
+
+/*!********************************************************************************************************************
+ *  \class      ProcessTransport
+ *  \brief      Communication backend of a RobotProcess.
+ *  \details    The lifecycle, the run loops and the statistics of RobotProcess do not depend on the middleware: its
+ *              parameters, its requests, its publications, and the serving of callbacks go through this interface.
+ *              RosTransport implements it with roscpp; InProcessTransport implements it with direct calls, so a
+ *              process can be executed without a ROS master. Parameter names are relative to the process, without
+ *              the leading '~'.
+ *
+ *********************************************************************************************************************/
+class ProcessTransport
+{
+public:
+  virtual ~ProcessTransport()
+  {
+  }
+
+  //! Returns the name of the process, used in the log messages and in the state board.
+  virtual std::string processName() const = 0;
+
+  //! Reads a parameter of the process, or 'default_value' if it is not set.
+  virtual void param(const std::string& name, bool& value, bool default_value) = 0;
+  virtual void param(const std::string& name, int& value, int default_value) = 0;
+  virtual void param(const std::string& name, double& value, double default_value) = 0;
+  virtual void param(const std::string& name, std::string& value, const std::string& default_value) = 0;
+  virtual void param(const std::string& name, std::vector<int>& value, const std::vector<int>& default_value) = 0;
+
+  //! Creates the request endpoints and the publications of the process. Requests are not served yet.
+  virtual void advertise(const ProcessRequestHandlers& handlers) = 0;
+
+  /*!******************************************************************************************************************
+   * \brief Starts serving the requests.
+   * \param data_threads If greater than 0, threads serving the data callbacks of the process, which must not call
+   * spin() nor spinOnce() in that case.
+   *******************************************************************************************************************/
+  virtual void startServing(int data_threads) = 0;
+
+  //! Stops serving requests and callbacks. The handlers are not called after it returns.
+  virtual void shutdown() = 0;
+
+  //! Publishes a transition of the process.
+  virtual void publishStateChange(const ProcessStateChange& change) = 0;
+
+  //! Publishes a heartbeat of the process.
+  virtual void publishHeartbeat(const ProcessHeartbeatInfo& heartbeat) = 0;
+
+  //! Publishes the metrics of a period.
+  virtual void publishMetrics(const ProcessMetrics& metrics) = 0;
+
+  //! Returns false when the process has to finish its loops.
+  virtual bool ok() const = 0;
+
+  //! Serves the data callbacks that are ready, if they are not served by threads of the transport.
+  virtual void spinOnce() = 0;
+
+  //! Serves the data callbacks, if they are not served by threads of the transport, until ok() is false.
+  virtual void spin() = 0;
+};
+#endif
@@ -0,0 +1,121 @@
+/*!*******************************************************************************************
+ *  \file       realtime_thread.h
+ *  \brief      RealtimeThread definition file.
+ *  \details    This file contains the RealtimeConfig structure and the RealtimeThread
+ *              declaration. To obtain more information about it's definition consult the
+ *              realtime_thread.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef REALTIME_THREAD
+#define REALTIME_THREAD
+
+#include <functional>
+#include <vector>
+#include <stddef.h>
+#include <pthread.h>
+
+//! Configuration of the real-time execution of a thread.
+struct RealtimeConfig
+{
+  bool enabled;                 //!< Applies the rest of the configuration, a plain thread is created if false.
+  int priority;                 //!< SCHED_FIFO priority, from 1 to 99.
+  std::vector<int> cpus;        //!< CPUs the thread is pinned to, all of them if empty. Missing CPUs are ignored.
+  bool lock_memory;             //!< Locks the memory of the OS process with mlockall().
+  size_t stack_prefault_bytes;  //!< Stack touched by the thread before running, so it is already mapped.
+  size_t heap_reserve_bytes;    //!< Heap touched and kept by malloc when the memory is locked.
+  long timer_slack_ns;          //!< Timer slack of the thread, unchanged if it is not positive.
+
+  RealtimeConfig()
+    : enabled(false)
+    , priority(80)
+    , lock_memory(true)
+    , stack_prefault_bytes(512 * 1024)
+    , heap_reserve_bytes(16 * 1024 * 1024)
+    , timer_slack_ns(1)
+  {
+  }
+};
+
+/*!********************************************************************************************************************
+ *  \class      RealtimeThread
+ *  \brief      Thread running with the SCHED_FIFO policy, pinned to a set of CPUs.
+ *  \details    Before running its body the thread sets its timer slack and prefaults its stack, so the first
+ *              iterations of a real-time loop do not suffer page faults. Setting a real-time policy needs the
+ *              CAP_SYS_NICE capability or an rtprio limit; when it is not allowed the thread is started with the
+ *              default policy and a warning is printed.
+ *
+ *********************************************************************************************************************/
+class RealtimeThread
+{
+private:
+  pthread_t thread;              //!< Handle of the thread.
+  bool started;                  //!< True between start() and join().
+  RealtimeConfig config;         //!< Configuration of the thread.
+  std::function<void()> body;    //!< Function executed by the thread.
+
+public:
+  //! Constructor.
+  RealtimeThread();
+
+  //! Waits for the thread if it was started.
+  ~RealtimeThread();
+
+  /*!******************************************************************************************************************
+   * \brief Starts a thread that executes 'thread_body' with the given configuration.
+   * \details If the configuration is not enabled, the thread is created with the default attributes.
+   * \return False if the thread could not be created.
+   *******************************************************************************************************************/
+  bool start(const RealtimeConfig& thread_config, const std::function<void()>& thread_body);
+
+  //! Waits until the thread finishes.
+  void join();
+
+  /*!******************************************************************************************************************
+   * \brief Prepares the memory of the OS process for real-time execution.
+   * \details Locks the current and future memory of the process with mlockall() and then disables the trimming of the
+   * heap and the use of mmap() by malloc and reserves 'heap_reserve_bytes' of heap.
+   * \return False, without changing malloc, if the memory could not be locked.
+   *******************************************************************************************************************/
+  static bool lockMemory(size_t heap_reserve_bytes);
+
+private:
+  static void* entry(void* argument);
+
+  //! Creates the thread, with the real-time attributes if 'realtime' is true.
+  bool create(bool realtime);
+
+  RealtimeThread(const RealtimeThread&) = delete;
+  RealtimeThread& operator=(const RealtimeThread&) = delete;
+};
+#endif
@@ -39,20 +39,34 @@
 #define ROBOT_PROCESS
 
 #include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 #include <stdio.h>
+#include <stdint.h>
+#include <time.h>
 #include <pthread.h>
 #include <ros/ros.h>
 #include <ros/callback_queue.h>
 #include <std_srvs/Empty.h>
 #include <std_msgs/String.h>
 
-#define STATE_CREATED 1
-#define STATE_READY_TO_START 2
-#define STATE_RUNNING 3
-#define STATE_PAUSED 4
-
-#define STATE_STARTED 7
-#define STATE_NOT_STARTED 8
+#include "process_state.h"
+#include "process_transport.h"
+#include "process_clock.h"
+#include "process_state_board.h"
+#include "seqlock.h"
+#include "latency_histogram.h"
+#include "tracer.h"
+#include "realtime_thread.h"
+#include "periodic_task_scheduler.h"
+#include "work_stealing_pool.h"
+#include "allocation_profiler.h"
+#include "cycle_arena.h"
 
 /*!********************************************************************************************************************
  *  \class      RobotProcess
@@ -62,86 +76,469 @@
  *              - Declaration of all the states a ROS node can be at.
  *              - Creation of a signal sending thread: By deriving this class the node will
  *                  create a thread with the only purpose of sending its state to a PerformanceMonitor,
- *                  that will be hearing at the 'State' topic.
+ *                  that will be hearing at the '~state' topic.
  *              - Declaration of methods that the derived class will have to implement in order to
  *                  add the desired functionality to the ROS node.
  *
  *********************************************************************************************************************/
 class RobotProcess
 {
+  // A chain executes its first stage with runCyclesAtRate() and the release of its cycles.
+  friend class ProcessChain;
+
   // variables
 public:
-  using State = uint8_t;
+  using State = ProcessState;
+
+  typedef uint32_t TriggerId;                  //!< Identifier of an input that triggers ownRun().
+  static const uint32_t MAX_TRIGGERS = 64;     //!< Maximum number of triggers of a process.
+
+  //! Condition on the triggers that makes runOnTriggers() call run().
+  enum class TriggerPolicy
+  {
+    ANY_OF,  //!< Any trigger has fired since the last run.
+    ALL_OF   //!< Every trigger has fired since the last run.
+  };
+
+  /*!******************************************************************************************************************
+   * \brief Timing statistics of the periodic execution performed by runAtRate().
+   * \details All durations are expressed in nanoseconds. The durations of run() are measured in real time, while the
+   * period, the deadlines and the jitter follow the clock of the process.
+   *******************************************************************************************************************/
+  struct RunStatistics
+  {
+    uint64_t cycles;                //!< Number of periods executed since runAtRate() was called.
+    uint64_t missed_deadlines;      //!< Number of periods skipped because run() finished after their deadline.
+    int64_t period_ns;              //!< Period requested to runAtRate().
+    int64_t last_run_duration_ns;   //!< Duration of the last run() call.
+    int64_t max_run_duration_ns;    //!< Longest run() call.
+    int64_t mean_run_duration_ns;   //!< Mean duration of the run() calls.
+    int64_t last_jitter_ns;         //!< Wake up delay of the last period with respect to its deadline.
+    int64_t max_jitter_ns;          //!< Longest wake up delay.
+  };
 
 protected:
-  ros::NodeHandle node_handler_robot_process;
+  std::shared_ptr<ProcessTransport> transport;  //!< Backend of the parameters, requests and publications.
+  int data_spinner_threads;                     //!< Threads serving the data callbacks, 0 if they are not used.
+  std::string trace_file;                       //!< File of the trace if this process enables the tracer first.
+  bool shut_down;                               //!< True once shutdown() has stopped the threads of the process.
+  std::shared_ptr<ProcessClock> clock;          //!< Time source of the loops, the periodic tasks and the signals.
+  bool lockstep;                                //!< Executes one cycle of runAtRate() per tick of the clock.
+  std::string lockstep_group;                   //!< Clock acknowledged in the state board, empty if none.
+
+  bool async_lifecycle;                                    //!< Runs ownStart() and ownStop() in the lifecycle worker.
+  std::thread lifecycle_worker;                            //!< Thread executing the asynchronous lifecycle steps.
+  std::deque<std::function<void()>> lifecycle_worker_jobs; //!< Lifecycle steps waiting for the worker.
+  std::mutex lifecycle_worker_mutex;                       //!< Protects the lifecycle worker jobs.
+  std::condition_variable lifecycle_worker_condition;      //!< Wakes up the lifecycle worker.
+  bool lifecycle_worker_active;                            //!< Keeps the lifecycle worker alive while true.
+
+  double heartbeat_rate;                      //!< Frequency of the heartbeat when the state does not change.
+  uint64_t heartbeat_seq;                     //!< Sequence number of the last heartbeat.
+  double metrics_rate;                        //!< Frequency of the metrics.
+  LatencyHistogram run_histogram;             //!< Durations of the ownRun() calls since the last metrics.
+  CycleArena cycle_arena;                     //!< Scratch memory of ownRun(), reset after every call.
+  std::thread signal_thread;                  //!< Thread sending the heartbeat.
+  std::mutex signal_mutex;                    //!< Protects the state changes pending to be signaled.
+  std::condition_variable signal_condition;   //!< Wakes up the signal thread when the state changes.
+  uint64_t state_changes;                     //!< Number of state changes, used to detect them in the signal thread.
+  bool signal_thread_active;                  //!< Keeps the signal thread alive while true.
 
-  ros::ServiceServer start_server_srv;  //!< ROS service handler used to order a process to start.
-  ros::ServiceServer stop_server_srv;   //!< ROS service handler used to order a process to stop.
-  ros::ServiceServer is_running_srv;    //!< ROS service handler used to check if a process is in RUNNING state.
+  ProcessStateBoard state_board;  //!< Slot of the process in the shared memory board of the host.
+  RealtimeConfig realtime_config; //!< Real-time configuration of the loop executed by runAtRate().
+
+  std::vector<std::string> trigger_names;     //!< Names of the triggers, indexed by TriggerId.
+  uint64_t declared_triggers;                 //!< Bit mask of the declared triggers.
+  std::atomic<uint64_t> pending_triggers;     //!< Bit mask of the triggers fired since the last run.
+  uint64_t fired_triggers;                    //!< Bit mask of the triggers that caused the current run.
+  std::atomic<TriggerPolicy> trigger_policy;  //!< Policy used by runOnTriggers(), read by the callbacks.
+  std::mutex trigger_mutex;                   //!< Mutex of the trigger condition and the trigger loop flag.
+  std::condition_variable trigger_condition;  //!< Wakes up the trigger loop.
+  bool trigger_loop_active;                   //!< Keeps the trigger loop alive while true.
+
+  PeriodicTaskScheduler task_scheduler;  //!< Executes the periodic tasks while the process is running.
+  WorkStealingPool worker_pool;          //!< Threads available to ownRun(), parked while the process is not running.
+
+  // Deprecated: kept for the derived classes written before ProcessTransport. They are copies of the services of the
+  // RosTransport, set in setUp(), and stay empty with other transports. The former 'node_handler_robot_process' could
+  // not be kept because a ros::NodeHandle member cannot be constructed without ros::init(), which the
+  // InProcessTransport does not need; getNodeHandle() replaces it.
+  ros::ServiceServer start_server_srv;  //!< \deprecated ROS service handler used to order a process to start.
+  ros::ServiceServer stop_server_srv;   //!< \deprecated ROS service handler used to order a process to stop.
+  ros::ServiceServer is_running_srv;    //!< \deprecated ROS service handler used to check if a process is running.
 
 protected:               //!< These attributes are protected because ProcessMonitor uses them.
-  State current_state;   //!< Attribute storing current state of the process.
+  std::atomic<State> current_state;  //!< Attribute storing current state of the process.
+  std::recursive_mutex transition_mutex;  //!< Serializes the transitions and the effects applied after them.
   std::string drone_id;  //!< Attribute storing the drone on which is executing the process.
   std::string hostname;  //!< Attribute storing the computer name on which the process is executing.
 
+  RunStatistics run_statistics;                //!< Timing statistics updated by the thread executing the loop.
+  SeqLock<RunStatistics> shared_run_statistics; //!< Copy of run_statistics that can be read from any thread.
+  int64_t scheduled_run_duration_ns;            //!< Sum of the durations of the cycles run by a scheduler.
+  int64_t cycle_release_ns;                     //!< Time of the clock at which the cycle of runAtRate() was released.
+  int64_t setup_time_ns;                        //!< Time of the clock at which setUp() was called.
+
   // methods
 public:
   //! Constructor.
   RobotProcess();
 
-  ~RobotProcess();
+  //! Calls shutdown() if the derived class did not, which is too late to be safe. The last process of the executable to
+  //! be destroyed writes the allocation counters to the log and the trace to its file.
+  virtual ~RobotProcess();
 
-  //!  This function calls to ownSetUp().
+  /*!*****************************************************************************************************************
+   * \brief This function calls to ownSetUp().
+   * \details The parameters are read and the requests advertised through the transport of the process, which is a
+   * RosTransport unless setTransport() was called. With it, the lifecycle services are attached to their own callback
+   * queue, which is served by a dedicated thread, so start and stop requests are never delayed by the data callbacks
+   * of the process. If the parameter '~data_spinner_threads' is greater than 0, the global callback queue is also
+   * served by an AsyncSpinner with that number of threads. In that case the derived process must not call
+   * ros::spinOnce() nor ros::spin().
+   *******************************************************************************************************************/
   void setUp();
 
-  //!  This function calls to ownStart().
-  //!  The first time is called this function calls to ownRun().
-  void start();
+  /*!*****************************************************************************************************************
+   * \brief Stops serving requests and joins every thread of the process that calls the 'own' functions.
+   * \details The transport stops serving requests, the step being executed by the lifecycle worker is finished and the
+   * pending ones are discarded, and the periodic tasks, the worker pool and the signal thread are stopped. After it
+   * returns no 'own' function nor periodic task is called anymore. Derived classes must call it from their destructor,
+   * while their members still exist:
+   * \code
+   * MyProcess::~MyProcess()
+   * {
+   *   shutdown();
+   * }
+   * \endcode
+   * The loops of runAtRate() and runOnTriggers() must have returned before. It can be called more than once.
+   *******************************************************************************************************************/
+  void shutdown();
+
+  /*!*****************************************************************************************************************
+   * \brief Sets the backend of the parameters, requests and publications of the process.
+   * \details It must be called before setUp(). With an InProcessTransport the process runs without a ROS master.
+   *******************************************************************************************************************/
+  void setTransport(const std::shared_ptr<ProcessTransport>& process_transport);
+
+  //! Returns the transport of the process, null before setUp() if none was set.
+  std::shared_ptr<ProcessTransport> getTransport() const
+  {
+    return transport;
+  }
+
+  /*!*****************************************************************************************************************
+   * \brief Sets the clock of the loops, the periodic tasks, the heartbeat and the metrics of the process.
+   * \details It must be called before setUp(). If it is not called, the parameter '~clock' selects a RealClock
+   * ("real", the default) or a RosClock ("ros"). With a simulated clock, such as a ManualClock, the process runs as
+   * fast as the clock is stepped.
+   *******************************************************************************************************************/
+  void setClock(const std::shared_ptr<ProcessClock>& process_clock);
+
+  //! Returns the clock of the process, null before setUp() if none was set.
+  std::shared_ptr<ProcessClock> getClock() const
+  {
+    return clock;
+  }
+
+  //! Returns the name of the process given by its transport, or the name of the ROS node if there is none.
+  std::string processName() const;
+
+  //! Returns the state, the uptime and the statistics of runAtRate(), as answered by the get_status service.
+  ProcessStatus getStatus() const;
+
+  /*!*****************************************************************************************************************
+   * \brief This function calls to ownStart() if the process is ready to start.
+   * \details The process is at STARTING state while ownStart() is executed and changes to RUNNING when it finishes.
+   * If the parameter '~async_lifecycle' is true, ownStart() is executed by the lifecycle worker thread and this
+   * function returns as soon as the process is at STARTING state. The end of the transition is published on
+   * '~state_event'.
+   * \return False, without calling ownStart(), if the process was not ready to start.
+   *******************************************************************************************************************/
+  bool start();
+
+  /*!*****************************************************************************************************************
+   * \brief This function calls to ownStop() if the process is running or paused.
+   * \details The process is at STOPPING state while ownStop() is executed and changes to READY_TO_START when it
+   * finishes. ownStop() is called once the periodic task being executed, if any, has finished. If the parameter
+   * '~async_lifecycle' is true, ownStop() is executed by the lifecycle worker thread and this function returns as soon
+   * as the process is at STOPPING state.
+   * \return False, without calling ownStop(), if the process was neither running nor paused.
+   *******************************************************************************************************************/
+  bool stop();
+
+  //!  This function calls to ownPause() if the process is running.
+  //!  Returns false, without calling ownPause(), if the process was not running.
+  bool pause();
 
-  //!  This function calls to ownStop().
-  void stop();
+  //!  This function calls to ownResume() if the process is paused.
+  //!  Returns false, without calling ownResume(), if the process was not paused.
+  bool resume();
 
   /*!*****************************************************************************************************************
    * \brief This function calls to ownRun() when the process is Running.
    * \details This function must be called by the user in ownRun when he is implementing a synchronus execution, when
    *using ros::spinOnce(). Don't use this function if using ros::spin().
+   * The duration of every ownRun() call is recorded in a histogram whose percentiles are published on '~metrics'.
    *******************************************************************************************************************/
   void run();
 
   /*!*****************************************************************************************************************
-   * \details If the node has an already defined state (Waiting, Running...) returns
-   * the state as an Integer, if not it returns -1 to indicate the current state is undefined.
+   * \brief Executes run() periodically at the given frequency until ROS is shut down.
+   * \details This function replaces the usual loop with ros::spinOnce(), run() and ros::Rate::sleep(). Every period
+   * is scheduled against an absolute deadline, so the time spent in run() does not make the period drift. When run()
+   * takes longer than a period the missed periods are skipped, keeping the original phase, and they are counted in
+   * the run statistics.
+   * If the parameter '~realtime/enabled' is true, the loop is executed by a RealtimeThread configured with the
+   * '~realtime' parameters, and the calling thread serves the callbacks until ROS is shut down.
+   * The periods follow the clock of the process. If the clock is simulated and the parameter '~lockstep' is true, the
+   * frequency is only informative: run() is called exactly once per tick of the clock, and the clock waits for it
+   * before the next tick. If the parameter '~lockstep_group' is not empty, which is the default with a RosClock, the
+   * ticks are also acknowledged in the state board for the LockstepCoordinator of that group.
+   * \param frequency Execution frequency in Hz.
+   *******************************************************************************************************************/
+  void runAtRate(double frequency);
+
+  /*!*****************************************************************************************************************
+   * \brief Executes run() every time the triggers of the process fire, until ROS is shut down.
+   * \details run() is called by a dedicated thread as soon as the trigger policy is satisfied, and the calling
+   * thread serves the callbacks. If the parameter '~realtime/enabled' is true, that thread is a RealtimeThread.
+   * \param policy        ANY_OF runs when any trigger fires, ALL_OF when all of them have fired.
+   * \param max_frequency Maximum frequency in Hz of the runs, unlimited if it is 0.
+   *******************************************************************************************************************/
+  void runOnTriggers(TriggerPolicy policy, double max_frequency = 0);
+
+  /*!*****************************************************************************************************************
+   * \brief Prepares the process to be executed by a scheduler, such as RunExecutor, at the given frequency.
+   * \details The run statistics are reset, as when runAtRate() is called.
+   *******************************************************************************************************************/
+  void beginScheduledRuns(double frequency);
+
+  /*!*****************************************************************************************************************
+   * \brief Executes a cycle released by a scheduler at time 'release_ns' of the clock of the process.
+   * \details The callbacks are served and run() is called, and the run statistics are updated as in runAtRate(): the
+   * jitter is the delay between the release and the start of the cycle, and the deadline of the cycle is the next
+   * release.
+   *******************************************************************************************************************/
+  void runScheduledCycle(int64_t release_ns);
+
+  //! Returns the timing statistics collected by runAtRate() or a scheduler. It can be called from any thread.
+  RunStatistics getRunStatistics() const;
+
+  //! Returns the timing statistics of the periodic tasks, in order of addition.
+  std::vector<PeriodicTaskScheduler::TaskStatistics> getTaskStatistics() const;
+
+  /*!*****************************************************************************************************************
+   * \details Returns the state (Waiting, Running...) the node is at.
+   * The state is read with a single atomic load, so this function can be called from any thread.
    * \return Void function
    *******************************************************************************************************************/
-  State getState();
+  State getState() const;
+
+  //! Returns true if the process is at RUNNING state.
+  bool isRunning() const
+  {
+    return getState() == State::RUNNING;
+  }
 
   /*!******************************************************************************************************************
-   * \details The function accepts one of the already defined states to modify the 'curent_state' attribute.
-   * It also sends and alive message to the PerformanceMonitor indicating the new state of the node.
+   * \details The function modifies the 'curent_state' attribute if the transition from the current state to the new
+   * one is legal according to the PROCESS_STATE_TRANSITIONS table. Illegal transitions are rejected without
+   * modifying the state.
    * \param   new_state The new state the process is going to have.
-   * \return  The current state of the process.
+   * \return  True if the state was changed.
+   *******************************************************************************************************************/
+  bool setState(State new_state);
+
+  /*!******************************************************************************************************************
+   * \details Former setState(), for the processes that set their state with its numeric value. Any state is accepted,
+   * as before the transition table: a transition that is not in the table is applied and logged as a warning. Values
+   * that are not a state are rejected.
+   * \param   new_state The numeric value of the new state, as returned by processStateIndex().
+   * \return  True if the state was changed.
    *******************************************************************************************************************/
-  void setState(State new_state);
+  bool setState(uint8_t new_state);
+
+  /*!******************************************************************************************************************
+   * \brief Atomically changes the state from 'from' to 'to'.
+   * \details The change is done with a compare-and-swap, so when several threads try to leave the same state only
+   * one of them succeeds. Illegal transitions are always rejected. Transitions are serialized by the transition mutex,
+   * so the effects applied with them follow the order of the transitions, while getState() never waits for them.
+   * \param   from The state the process must be at.
+   * \param   to   The new state of the process.
+   * \return  True if the process was at 'from' and now is at 'to', false if the state was not changed.
+   *******************************************************************************************************************/
+  bool tryTransition(State from, State to);
+
+  //! Same as tryTransition(from, to), but the legality of the transition is checked at compile time.
+  template <State from, State to>
+  bool tryTransition()
+  {
+    static_assert(isLegalTransition(from, to), "Illegal RobotProcess state transition");
+    std::lock_guard<std::recursive_mutex> lock(transition_mutex);
+    State expected = from;
+    if (!current_state.compare_exchange_strong(expected, to, std::memory_order_acq_rel, std::memory_order_acquire))
+      return false;
+
+    notifyStateChange(from, to);
+    return true;
+  }
 
 protected:
   /*!******************************************************************************************************************
-   * \brief This ROS service set RobotProcess in READY_TO_START state and calls function stop.
-   * \details Currently, this service should only be called if the process is running. In the future
-   * it will also be correct to call this service when the process is paused.
-   * \param [in] request
-   * \param [in] response
+   * \brief Returns a subscriber callback that only calls 'callback' while the process is running.
+   * \details Subscribers created in ownStart() with this callback stay connected while the process is paused, but
+   * the messages received in that state are discarded. Example:
+   * \code
+   * imu_sub = n.subscribe<sensor_msgs::Imu>("imu", 1, gatedCallback(&MyProcess::imuCallback, this));
+   * \endcode
    *******************************************************************************************************************/
-  bool stopSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response);
+  template <class M, class T>
+  boost::function<void(const boost::shared_ptr<M const>&)>
+  gatedCallback(void (T::*callback)(const boost::shared_ptr<M const>&), T* object)
+  {
+    return [this, callback, object](const boost::shared_ptr<M const>& message) {
+      ROBOT_PROCESS_ALLOCATION_PHASE(CALLBACK);
+      if (isRunning())
+        (object->*callback)(message);
+    };
+  }
+
+  //! Starts a cycle of run(). Returns the CLOCK_MONOTONIC time at which it started.
+  int64_t beginRunCycle();
+
+  //! Finishes a cycle of run() that started at 'run_start_ns': resets the cycle arena and records the duration.
+  void endRunCycle(int64_t run_start_ns);
 
   /*!******************************************************************************************************************
-   * \brief This ROS service set RobotProcess in RUNNING state and calls function start.
-   * \details Currently, this service should only be called if the process is ready to start. In the future
-   * it will also be correct to call this service when the process is paused or running.
-   * \param [in] request
-   * \param [in] response
+   * \brief Implementation of runAtRate() that calls 'cycle' instead of run() every period.
+   * \details The loop is a template, so a cycle known at compile time, as the one of RobotProcessT, is inlined in it.
    *******************************************************************************************************************/
-  bool startSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response);
+  template <class Cycle>
+  void runCyclesAtRate(double frequency, const Cycle& cycle)
+  {
+    if (frequency <= 0)
+    {
+      ROS_ERROR("In node %s, runAtRate was called with an invalid frequency %f", processName().c_str(), frequency);
+      return;
+    }
+    if (!transport)
+    {
+      ROS_ERROR("Node %s called runAtRate before setUp", processName().c_str());
+      return;
+    }
+
+    if (realtime_config.enabled)
+    {
+      if (runInLoopThread([this, frequency, cycle]() { rateLoop(frequency, false, cycle); }))
+        return;
+      ROS_ERROR("Node %s could not create its real-time thread, running in the calling thread",
+                processName().c_str());
+    }
+
+    rateLoop(frequency, data_spinner_threads == 0, cycle);
+  }
+
+private:
+  //! Schedule of a loop of runAtRate().
+  struct RateLoop
+  {
+    int64_t period_ns;              //!< Period of the loop.
+    int64_t deadline_ns;            //!< Time of the clock at which the current period finishes.
+    int64_t total_run_duration_ns;  //!< Sum of the durations of the cycles.
+    bool lockstep;                  //!< True if the loop executes one cycle per tick of the clock.
+    uint64_t tick;                  //!< Last tick of the clock executed by the loop in lockstep.
+  };
+
+  //! Loop of runAtRate(). The global callback queue is served between periods if 'spin_callbacks' is true.
+  template <class Cycle>
+  void rateLoop(double frequency, bool spin_callbacks, const Cycle& cycle)
+  {
+    RateLoop loop = beginRateLoop(frequency);
+    while (transport->ok())
+    {
+      if (loop.lockstep && !clock->waitForTick(loop.tick, loop.tick))
+        continue;
+      cycle_release_ns = loop.lockstep ? clock->now() : loop.deadline_ns - loop.period_ns;
+      const int64_t run_start_ns = beginRateCycle(spin_callbacks);
+      cycle();
+      endRateCycle(loop, run_start_ns);
+    }
+    endRateLoop(loop);
+  }
+
+  //! Resets the run statistics and schedules the first period of a loop of runAtRate().
+  RateLoop beginRateLoop(double frequency);
+
+  //! Resets the run statistics of a loop with the given period.
+  void resetRunStatistics(int64_t period_ns);
+
+  //! Adds the duration of the cycle that started at 'run_start_ns' to the run statistics and to 'total_duration_ns'.
+  void recordRunDuration(int64_t& total_duration_ns, int64_t run_start_ns);
+
+  //! Adds the delay with which a cycle started to the run statistics.
+  void recordJitter(int64_t jitter_ns);
+
+  //! Serves the callbacks if 'spin_callbacks' is true. Returns the CLOCK_MONOTONIC time at which the cycle starts.
+  int64_t beginRateCycle(bool spin_callbacks);
+
+  /*!******************************************************************************************************************
+   * \brief Updates the run statistics with the cycle that started at 'run_start_ns'.
+   * \details Then it sleeps until the next period or, in lockstep, tells the clock that the tick is completed.
+   *******************************************************************************************************************/
+  void endRateCycle(RateLoop& loop, int64_t run_start_ns);
+
+  //! Leaves the lockstep of the clock when a loop of runAtRate() finishes.
+  void endRateLoop(const RateLoop& loop);
+
+  /*!******************************************************************************************************************
+   * \brief Executes 'loop' in a RealtimeThread while the calling thread serves the callbacks until ROS is shut down.
+   * \details Then 'stop_loop', if it is given, wakes up the loop so it can finish before it is joined.
+   *******************************************************************************************************************/
+  bool runInLoopThread(const std::function<void()>& loop,
+                       const std::function<void()>& stop_loop = std::function<void()>());
+
+  //! Returns true if the fired triggers satisfy the trigger policy.
+  bool triggersReady(uint64_t triggers) const;
+
+  //! Loop of runOnTriggers(). Consecutive runs are separated at least 'min_period_ns'.
+  void triggerLoop(int64_t min_period_ns);
+
+  //! Makes the trigger loop finish as soon as its current run() returns.
+  void stopTriggerLoop();
+
+  //! Executes the lifecycle steps queued by start() and stop() when '~async_lifecycle' is true.
+  void lifecycleWorker();
+
+  //! Executes a lifecycle step, in the lifecycle worker if '~async_lifecycle' is true or immediately if not.
+  void runLifecycleStep(const std::function<void()>& step);
+
+  //! Publishes the transition on '~state_event' and wakes up the signal thread, with the transition mutex held.
+  void notifyStateChange(State previous_state, State new_state);
+
+  /*!******************************************************************************************************************
+   * \details Publishes a heartbeat every time the state changes and, if '~heartbeat_rate' is greater than 0, every
+   * time a heartbeat period passes without changes. Changes that happen while a heartbeat is being published are
+   * coalesced into the next one, which carries the latest state. It also publishes the metrics of ownRun() at
+   * '~metrics_rate'.
+   *******************************************************************************************************************/
+  void signalThread();
+
+  //! Publishes the current state on '~state'.
+  void publishHeartbeat();
+
+  //! Publishes the percentiles of the ownRun() durations since the previous metrics on '~metrics'.
+  void publishMetrics();
+
+  /*!******************************************************************************************************************
+   * \brief Writes the events recorded by the Tracer, those of every process of the executable, to the '~trace_file'
+   * of the first process that enabled the tracer.
+   * \return False if the trace could not be written.
+   *******************************************************************************************************************/
+  bool dumpTrace();
+
+  //! Returns the trace file used when '~trace_file' is not set.
+  std::string defaultTraceFile() const;
 
 protected:
   /*!******************************************************************************************************************
@@ -171,5 +568,109 @@ protected:
    * The user should define this function only when implementing a synchronus execution
    *******************************************************************************************************************/
   virtual void ownRun() = 0;
+
+  /*!******************************************************************************************************************
+   * \brief Declares an input that triggers ownRun() when runOnTriggers() is used.
+   * \details Triggers must be declared in ownSetUp(), up to MAX_TRIGGERS.
+   * \param name Name of the input.
+   * \return Identifier of the trigger, to be used with notifyTrigger() and wasTriggered().
+   *******************************************************************************************************************/
+  TriggerId addTrigger(const std::string& name);
+
+  /*!******************************************************************************************************************
+   * \brief Adds a task executed periodically while the process is at RUNNING state.
+   * \details Tasks must be added in ownSetUp(). They are executed, independently of ownRun(), by the threads of a
+   * PeriodicTaskScheduler, whose number is given by the parameter '~scheduler_threads'. Among the tasks ready to run,
+   * the one with the highest priority is executed first, and tasks with the same priority are ordered by rate.
+   * \param name     Name of the task.
+   * \param rate     Frequency of the task in Hz.
+   * \param function Function executed every period.
+   * \param priority Priority of the task.
+   * \return Identifier of the task, PeriodicTaskScheduler::INVALID_TASK if the rate is not positive.
+   *******************************************************************************************************************/
+  PeriodicTaskScheduler::TaskId addPeriodicTask(const std::string& name, double rate,
+                                                const std::function<void()>& function, int priority = 0);
+
+  /*!******************************************************************************************************************
+   * \brief This ROS service set RobotProcess in READY_TO_START state and calls function stop.
+   * \deprecated The stop service is served by the transport, this function only calls stop().
+   * \param [in] request
+   * \param [in] response
+   *******************************************************************************************************************/
+  bool stopSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response);
+
+  /*!******************************************************************************************************************
+   * \brief This ROS service set RobotProcess in RUNNING state and calls function start.
+   * \deprecated The start service is served by the transport, this function only calls start().
+   * \param [in] request
+   * \param [in] response
+   *******************************************************************************************************************/
+  bool startSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response);
+
+  /*!******************************************************************************************************************
+   * \brief Returns a node handle in the namespace of the process, equivalent to ros::NodeHandle().
+   * \details Processes that may be hosted by robot_process_container must create their publishers, subscribers and
+   * timers with it, so they are resolved in the namespace of the process and their callbacks are served by its own
+   * loop. Messages published as a shared pointer are then delivered to the subscribers of the same container without
+   * being copied nor serialized, so they must not be modified after being published.
+   *******************************************************************************************************************/
+  ros::NodeHandle getNodeHandle();
+
+  //! Returns a node handle in the private namespace of the process, equivalent to ros::NodeHandle("~").
+  ros::NodeHandle getPrivateNodeHandle();
+
+  /*!******************************************************************************************************************
+   * \brief Returns the pool of threads that ownRun() can use to execute work in parallel.
+   * \details The threads are created in setUp(), their number is given by the parameter '~worker_threads', and they
+   * are kept across start() and stop(). While the process is not at RUNNING state they sleep as soon as they are idle.
+   * Without threads, parallelFor() and TaskGroup execute everything in the calling thread. For example:
+   * \code
+   * workerPool().parallelFor(0, points.size(), [&](size_t i) { transformPoint(points[i]); });
+   * \endcode
+   *******************************************************************************************************************/
+  WorkStealingPool& workerPool()
+  {
+    return worker_pool;
+  }
+
+  /*!******************************************************************************************************************
+   * \brief Returns the arena for the scratch memory of ownRun().
+   * \details Every allocation made in the arena is released when ownRun() returns, so nothing allocated in it may be
+   * kept between cycles. Its first chunk has '~arena_bytes' bytes. It must only be used by the thread executing
+   * ownRun(). For example:
+   * \code
+   * ArenaVector<Point> points{ ArenaAllocator<Point>(cycleArena()) };
+   * \endcode
+   *******************************************************************************************************************/
+  CycleArena& cycleArena()
+  {
+    return cycle_arena;
+  }
+
+  //! Marks a trigger as fired. It is usually called by the callback that receives the input. Thread safe.
+  void notifyTrigger(TriggerId trigger);
+
+  //! Returns true, inside ownRun(), if the trigger fired since the previous run.
+  bool wasTriggered(TriggerId trigger) const
+  {
+    return trigger < MAX_TRIGGERS && (fired_triggers & (static_cast<uint64_t>(1) << trigger)) != 0;
+  }
+
+  /*!******************************************************************************************************************
+   * \details This function is executed in pause(). Publishers and subscribers must not be shut down here, so the
+   * process can resume without reconnecting them. While the process is paused run() does not call ownRun().
+   * Implementing it is optional.
+   *******************************************************************************************************************/
+  virtual void ownPause()
+  {
+  }
+
+  /*!******************************************************************************************************************
+   * \details This function is executed in resume(), after the process is back at RUNNING state.
+   * Implementing it is optional.
+   *******************************************************************************************************************/
+  virtual void ownResume()
+  {
+  }
 };
 #endif
@@ -0,0 +1,92 @@
+/*!*******************************************************************************************
+ *  \file       robot_process_t.h
+ *  \brief      RobotProcessT definition file.
+ *  \details    This file contains the RobotProcessT template, a RobotProcess whose ownRun() is
+ *              called without virtual dispatch. It is header only.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef ROBOT_PROCESS_T
+#define ROBOT_PROCESS_T
+
+#include <type_traits>
+
+#include "robot_process.h"
+
+/*!********************************************************************************************************************
+ *  \class      RobotProcessT
+ *  \brief      RobotProcess whose run() calls the ownRun() of the derived class directly.
+ *  \details    The derived class passes itself as template argument and implements the same own* functions as with
+ *              RobotProcess. run() and runAtRate() are hidden by versions that call Derived::ownRun() with a
+ *              qualified call, so the compiler can inline it into the run loop; the rest of the lifecycle, the
+ *              services and the statistics are those of RobotProcess. The derived class must declare
+ *              RobotProcessT<Derived> as friend if its ownRun() is not public. For example:
+ *              \code
+ *              class MyProcess final : public RobotProcessT<MyProcess>
+ *              {
+ *                friend class RobotProcessT<MyProcess>;
+ *                ...
+ *              };
+ *              \endcode
+ *              The process must be used through the derived type: run() and runAtRate() called through a
+ *              RobotProcess pointer or reference use the virtual call.
+ *
+ *********************************************************************************************************************/
+template <class Derived>
+class RobotProcessT : public RobotProcess
+{
+public:
+  //! Same as RobotProcess::run(), calling Derived::ownRun() without virtual dispatch.
+  void run()
+  {
+    static_assert(std::is_base_of<RobotProcessT<Derived>, Derived>::value,
+                  "RobotProcessT must be instantiated with the class that derives from it");
+    if (isRunning())
+    {
+      const int64_t run_start_ns = beginRunCycle();
+      {
+        ROBOT_PROCESS_TRACE_SCOPE("ownRun");
+        ROBOT_PROCESS_ALLOCATION_PHASE(RUN);
+        static_cast<Derived*>(this)->Derived::ownRun();
+      }
+      endRunCycle(run_start_ns);
+    }
+  }
+
+  //! Same as RobotProcess::runAtRate(), with run() inlined in the loop.
+  void runAtRate(double frequency)
+  {
+    runCyclesAtRate(frequency, [this]() { run(); });
+  }
+};
+#endif
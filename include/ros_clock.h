@@ -0,0 +1,84 @@
+/*!*******************************************************************************************
+ *  \file       ros_clock.h
+ *  \brief      RosClock definition file.
+ *  \details    This file contains the RosClock declaration. To obtain more information about it's
+ *              definition consult the ros_clock.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+
+#ifndef ROS_CLOCK
+#define ROS_CLOCK
+
+#include <atomic>
+#include <thread>
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <rosgraph_msgs/Clock.h>
+
+#include "process_clock.h"
+
+/*!********************************************************************************************************************
+ *  \class      RosClock
+ *  \brief      Simulated ProcessClock that follows the ROS '/clock' topic.
+ *  \details    Every message received on '/clock' is a tick, as a call to ManualClock::advanceTo(). The messages are
+ *              received by a dedicated thread with its own callback queue, which waits for the loops in lockstep
+ *              before taking the next message, so no tick is skipped while the subscriber queue does not overflow.
+ *              The time is 0 until the first message is received. ros::init() must have been called before it is
+ *              created.
+ *
+ *********************************************************************************************************************/
+class RosClock : public ManualClock
+{
+private:
+  ros::CallbackQueue clock_queue;          //!< Callback queue serving only the clock subscriber.
+  ros::NodeHandle node_handle;             //!< Node handle attached to the clock callback queue.
+  ros::Subscriber clock_sub;               //!< Subscriber of '/clock'.
+  std::thread clock_thread;                //!< Thread that serves the clock callback queue.
+  std::atomic<bool> clock_thread_active;   //!< Keeps the clock thread alive while true.
+
+public:
+  //! Constructor. Subscribes to '/clock'.
+  RosClock();
+
+  //! Stops receiving the clock.
+  ~RosClock();
+
+private:
+  //! Serves the clock callback queue until the clock is destroyed.
+  void clockThread();
+
+  //! Advances the clock to the time of the message.
+  void clockCallback(const rosgraph_msgs::Clock::ConstPtr& message);
+};
+#endif
@@ -0,0 +1,235 @@
+/*!*******************************************************************************************
+ *  \file       ros_transport.h
+ *  \brief      RosTransport definition file.
+ *  \details    This file contains the RosTransport declaration. To obtain more information about
+ *              it's definition consult the ros_transport.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef ROS_TRANSPORT
+#define ROS_TRANSPORT
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <std_srvs/Empty.h>
+#include <std_srvs/Trigger.h>
+#include <robot_process/StateEvent.h>
+#include <robot_process/ProcessHeartbeat.h>
+#include <robot_process/RunMetrics.h>
+#include <robot_process/GetProcessStatus.h>
+
+#include "process_transport.h"
+
+/*!********************************************************************************************************************
+ *  \class      RosTransport
+ *  \brief      ProcessTransport of a ROS node. It is the transport of a RobotProcess unless another one is set.
+ *  \details    The requests are ROS services named after the node. The lifecycle services (start, stop, pause,
+ *              resume and dump_trace) are attached to their own callback queue and the query services (is_running
+ *              and get_status) to another one, each served by a dedicated thread, so start and stop requests are
+ *              never delayed by the data callbacks and queries never wait for a lifecycle step. The publications are
+ *              '~state_event', '~state' and '~metrics'. ros::init() must have been called before it is created.
+ *              A transport created with a process name hosts the process inside a node shared with other processes,
+ *              as robot_process_container does: its services, topics and parameters are under that name instead of
+ *              the name of the node, and its data callbacks have their own callback queue, served by the process
+ *              exactly as the global queue of a node of its own.
+ *
+ *********************************************************************************************************************/
+class RosTransport : public ProcessTransport
+{
+private:
+  std::string name;                               //!< Name of the process, the name of the node if not hosted.
+  bool hosted;                                    //!< True if the process shares the node with other processes.
+  std::map<std::string, std::string> remappings;  //!< Remappings of the names resolved by the node handles.
+  ros::CallbackQueue data_queue;                  //!< Callback queue of the data callbacks of a hosted process.
+
+  ros::NodeHandle node_handle;               //!< Node handle of the publications.
+  ros::CallbackQueue lifecycle_queue;        //!< Callback queue serving only the lifecycle services.
+  ros::NodeHandle node_handle_lifecycle;     //!< Node handle attached to the lifecycle callback queue.
+  std::thread lifecycle_thread;              //!< Thread that serves the lifecycle callback queue.
+  ros::CallbackQueue query_queue;            //!< Callback queue serving only the state query services.
+  ros::NodeHandle node_handle_query;         //!< Node handle attached to the query callback queue.
+  std::thread query_thread;                  //!< Thread that serves the query callback queue.
+  std::atomic<bool> service_threads_active;  //!< Keeps the lifecycle and query threads alive while true.
+
+  std::unique_ptr<ros::AsyncSpinner> data_spinner;  //!< Spinner serving the data callback queue.
+
+  ros::ServiceServer start_server_srv;  //!< ROS service handler used to order a process to start.
+  ros::ServiceServer stop_server_srv;   //!< ROS service handler used to order a process to stop.
+  ros::ServiceServer pause_server_srv;  //!< ROS service handler used to order a process to pause.
+  ros::ServiceServer resume_server_srv; //!< ROS service handler used to order a paused process to resume.
+  ros::ServiceServer dump_trace_srv;    //!< ROS service handler used to write the trace of the process.
+  ros::ServiceServer is_running_srv;    //!< ROS service handler used to check if a process is in RUNNING state.
+  ros::ServiceServer get_status_srv;    //!< ROS service handler used to query the state and run statistics.
+
+  ros::Publisher state_event_pub;  //!< Publishes every transition of the process on '~state_event'.
+  ros::Publisher heartbeat_pub;    //!< Publishes the state of the process on '~state'.
+  ros::Publisher metrics_pub;      //!< Publishes the ownRun() duration percentiles on '~metrics'.
+
+  ProcessRequestHandlers handlers;  //!< Functions of the process called by the services.
+
+public:
+  //! Constructor of the transport of a process that is the only one of its node.
+  RosTransport();
+
+  /*!******************************************************************************************************************
+   * \brief Constructor of the transport of a process hosted in a node shared with other processes.
+   * \param process_name         Resolved name of the process, whose namespace contains its services and topics.
+   * \param process_remappings   Remappings applied to the names resolved by the node handles of the process.
+   *******************************************************************************************************************/
+  explicit RosTransport(const std::string& process_name,
+                        const std::map<std::string, std::string>& process_remappings =
+                            std::map<std::string, std::string>());
+
+  //! Stops serving the services.
+  ~RosTransport();
+
+  std::string processName() const;
+
+  void param(const std::string& name, bool& value, bool default_value);
+  void param(const std::string& name, int& value, int default_value);
+  void param(const std::string& name, double& value, double default_value);
+  void param(const std::string& name, std::string& value, const std::string& default_value);
+  void param(const std::string& name, std::vector<int>& value, const std::vector<int>& default_value);
+
+  void advertise(const ProcessRequestHandlers& process_handlers);
+  void startServing(int data_threads);
+  void shutdown();
+
+  void publishStateChange(const ProcessStateChange& change);
+  void publishHeartbeat(const ProcessHeartbeatInfo& heartbeat);
+  void publishMetrics(const ProcessMetrics& metrics);
+
+  bool ok() const;
+  void spinOnce();
+  void spin();
+
+  /*!******************************************************************************************************************
+   * \brief Returns a node handle in the namespace of the process.
+   * \details Its subscriptions and timers are attached to the data callback queue of the process, so they are
+   * served by run() loops and spin() as in a node of its own. It is equivalent to ros::NodeHandle() when the process
+   * is not hosted.
+   *******************************************************************************************************************/
+  ros::NodeHandle nodeHandle();
+
+  //! Returns a node handle in the private namespace of the process, equivalent to ros::NodeHandle("~") when the
+  //! process is not hosted.
+  ros::NodeHandle privateNodeHandle();
+
+  //! Returns the start service, for the deprecated RobotProcess::start_server_srv.
+  ros::ServiceServer startService() const
+  {
+    return start_server_srv;
+  }
+
+  //! Returns the stop service, for the deprecated RobotProcess::stop_server_srv.
+  ros::ServiceServer stopService() const
+  {
+    return stop_server_srv;
+  }
+
+  //! Returns the is_running service, for the deprecated RobotProcess::is_running_srv.
+  ros::ServiceServer isRunningService() const
+  {
+    return is_running_srv;
+  }
+
+private:
+  //! Returns the name of a parameter of the process.
+  std::string paramName(const std::string& param_name) const;
+
+  //! Serves a callback queue until the transport is shut down, which disables the queue to wake the thread up.
+  void serviceThread(ros::CallbackQueue* queue);
+
+  /*!******************************************************************************************************************
+   * \brief This ROS service set RobotProcess in READY_TO_START state and calls function stop.
+   * \details This service should only be called if the process is running or paused.
+   * \param [in] request
+   * \param [in] response
+   *******************************************************************************************************************/
+  bool stopSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response);
+
+  /*!******************************************************************************************************************
+   * \brief This ROS service set RobotProcess in RUNNING state and calls function start.
+   * \details Currently, this service should only be called if the process is ready to start. In the future
+   * it will also be correct to call this service when the process is paused or running.
+   * \param [in] request
+   * \param [in] response
+   *******************************************************************************************************************/
+  bool startSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response);
+
+  /*!******************************************************************************************************************
+   * \brief This ROS service set RobotProcess in PAUSED state and calls function pause.
+   * \details This service should only be called if the process is running.
+   * \param [in] request
+   * \param [in] response
+   *******************************************************************************************************************/
+  bool pauseSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response);
+
+  /*!******************************************************************************************************************
+   * \brief This ROS service set RobotProcess in RUNNING state and calls function resume.
+   * \details This service should only be called if the process is paused.
+   * \param [in] request
+   * \param [in] response
+   *******************************************************************************************************************/
+  bool resumeSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response);
+
+  /*!******************************************************************************************************************
+   * \brief This ROS service answers if the process is at RUNNING state.
+   * \details Like every query service, it is served by the query thread and only reads the atomic state, so it never
+   * waits for the lifecycle or data callbacks.
+   * \param [in] request
+   * \param [out] response 'success' is true if the process is running, 'message' is the name of its state.
+   *******************************************************************************************************************/
+  bool isRunningSrvCall(std_srvs::Trigger::Request& request, std_srvs::Trigger::Response& response);
+
+  /*!******************************************************************************************************************
+   * \brief This ROS service returns the state, the uptime and the run statistics of the process.
+   * \param [in] request
+   * \param [out] response
+   *******************************************************************************************************************/
+  bool getStatusSrvCall(robot_process::GetProcessStatus::Request& request,
+                        robot_process::GetProcessStatus::Response& response);
+
+  /*!******************************************************************************************************************
+   * \brief This ROS service writes the events recorded by the Tracer to '~trace_file' in Chrome trace format.
+   * \param [in] request
+   * \param [in] response
+   *******************************************************************************************************************/
+  bool dumpTraceSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response);
+};
+#endif
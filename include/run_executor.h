@@ -0,0 +1,166 @@
+/*!*******************************************************************************************
+ *  \file       run_executor.h
+ *  \brief      RunExecutor definition file.
+ *  \details    This file contains the RunExecutor declaration. To obtain more information about
+ *              it's definition consult the run_executor.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+
+#ifndef RUN_EXECUTOR
+#define RUN_EXECUTOR
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "process_clock.h"
+#include "realtime_thread.h"
+
+class RobotProcess;
+
+/*!********************************************************************************************************************
+ *  \class      RunExecutor
+ *  \brief      Executes the run() loops of many processes, each at its own rate, on a small pool of threads.
+ *  \details    Instead of a thread sleeping in runAtRate() for every process, the processes added to the executor
+ *              are released periodically and executed by the first free thread, in earliest deadline first order,
+ *              where the deadline of a release is the next one. Before every run() the callbacks of the process are
+ *              served with the spinOnce() of its transport, so they never overlap its ownRun(). This is only the
+ *              case when every process has a callback queue of its own, as the processes hosted by
+ *              robot_process_container; with the global queue, the callbacks of any process may be served before
+ *              the run() of another. A process is never executed by two threads at the same time. When a run()
+ *              finishes after its deadline it is counted as an overrun, and the releases that have expired are
+ *              skipped, as runAtRate() skips its periods, keeping the phase of the process.
+ *
+ *********************************************************************************************************************/
+class RunExecutor
+{
+public:
+  typedef uint32_t JobId;                      //!< Identifier of a job, in order of addition.
+  static const JobId INVALID_JOB = 0xFFFFFFFF;  //!< Returned when a job is rejected.
+
+  //! Timing statistics of a job. Durations are measured in real time and release times with the clock.
+  struct JobStatistics
+  {
+    std::string name;           //!< Name of the job, the name of the process for processes.
+    double rate;                //!< Frequency of the job in Hz.
+    uint64_t runs;              //!< Number of executions.
+    uint64_t overruns;          //!< Executions that finished after their deadline.
+    uint64_t skipped_releases;  //!< Releases skipped because they expired before the previous execution finished.
+    int64_t last_duration_ns;   //!< Duration of the last execution.
+    int64_t max_duration_ns;    //!< Longest execution.
+    int64_t mean_duration_ns;   //!< Mean duration of the executions.
+    int64_t max_lateness_ns;    //!< Longest delay between a release and the start of its execution.
+  };
+
+private:
+  struct Job
+  {
+    JobStatistics statistics;               //!< Configuration and statistics of the job.
+    std::function<void(int64_t)> function;  //!< Function executed at every release, given the time of the release.
+    RobotProcess* process;                  //!< Process executed by the job, nullptr for other functions.
+    int64_t period_ns;                      //!< Period of the job.
+    int64_t release_ns;                     //!< Time of the clock of the current release. Its deadline is the next one.
+    int64_t total_duration_ns;              //!< Sum of the durations of the executions.
+  };
+
+  std::vector<std::unique_ptr<Job>> jobs;                //!< Jobs in order of addition.
+  std::vector<Job*> ready;                               //!< Released jobs, a heap ordered by deadline.
+  std::vector<Job*> waiting;                             //!< Jobs waiting for their release, a heap ordered by release.
+  std::vector<std::unique_ptr<RealtimeThread>> workers;  //!< Threads executing the jobs.
+  mutable std::mutex mutex;                              //!< Protects the jobs, the heaps and the flag.
+  std::condition_variable condition;                     //!< Wakes up the workers.
+  bool active;                                           //!< Keeps the workers alive while true.
+  std::shared_ptr<ProcessClock> clock;                   //!< Clock of the releases.
+  ProcessClock::ListenerId clock_listener;               //!< Wakes up the workers when a simulated clock advances.
+
+public:
+  //! Constructor.
+  RunExecutor();
+
+  //! Stops the workers.
+  ~RunExecutor();
+
+  //! Sets the clock of the releases, a RealClock by default. It must be called before start().
+  void setClock(const std::shared_ptr<ProcessClock>& executor_clock);
+
+  /*!******************************************************************************************************************
+   * \brief Adds a process whose run() is executed at 'rate'. Processes must be added before start().
+   * \details The process must have been set up, and it must not be executed by runAtRate() nor runOnTriggers() too.
+   * Every release is executed with RobotProcess::runScheduledCycle(), so the run statistics, the metrics and the
+   * state board of the process are updated as with runAtRate(). The clock of the executor must be the clock of the
+   * process.
+   * \return Identifier of the job of the process, INVALID_JOB if the rate is not positive.
+   *******************************************************************************************************************/
+  JobId addProcess(RobotProcess& process, double rate);
+
+  /*!******************************************************************************************************************
+   * \brief Adds a function executed at 'rate', scheduled with the processes. Jobs must be added before start().
+   * \return Identifier of the job, INVALID_JOB if the rate is not positive.
+   *******************************************************************************************************************/
+  JobId addJob(const std::string& name, double rate, const std::function<void()>& function);
+
+  /*!******************************************************************************************************************
+   * \brief Adds a function executed at 'rate' that receives the time of the clock of every release, as the processes.
+   * Jobs must be added before start().
+   * \return Identifier of the job, INVALID_JOB if the rate is not positive.
+   *******************************************************************************************************************/
+  JobId addReleasedJob(const std::string& name, double rate, const std::function<void(int64_t)>& function);
+
+  /*!******************************************************************************************************************
+   * \brief Starts the threads executing the jobs, every one of them released immediately.
+   * \details The run statistics of the processes are reset with RobotProcess::beginScheduledRuns().
+   * \param threads Number of threads, usually not more than the cores available for the processes.
+   * \param config  Real-time configuration of the threads.
+   *******************************************************************************************************************/
+  void start(unsigned int threads, const RealtimeConfig& config = RealtimeConfig());
+
+  //! Stops and joins the threads. Jobs being executed are finished first.
+  void stop();
+
+  //! Returns the statistics of every job, in order of addition.
+  std::vector<JobStatistics> getStatistics() const;
+
+private:
+  //! Adds a job executing 'process', or 'function' if it is nullptr.
+  JobId addJob(const std::string& name, double rate, const std::function<void(int64_t)>& function,
+               RobotProcess* process);
+
+  //! Loop of the threads executing the jobs.
+  void worker();
+};
+#endif
@@ -0,0 +1,94 @@
+/*!*******************************************************************************************
+ *  \file       seqlock.h
+ *  \brief      SeqLock definition file.
+ *  \details    This file contains the SeqLock class template, used to share small structures
+ *              between one writer thread and any number of reader threads without locks.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef SEQLOCK
+#define SEQLOCK
+
+#include <atomic>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+
+/*!********************************************************************************************************************
+ *  \class      SeqLock
+ *  \brief      Sequence lock protecting a trivially copyable value.
+ *  \details    The writer never waits and readers never block the writer: a reader retries its copy when it
+ *              overlaps with a write. Only one thread can write the value.
+ *
+ *********************************************************************************************************************/
+template <class T>
+class SeqLock
+{
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock can only protect trivially copyable types");
+
+private:
+  std::atomic<uint32_t> sequence;  //!< Odd while the value is being written.
+  T value;                         //!< Protected value.
+
+public:
+  SeqLock() : sequence(0)
+  {
+    memset(&value, 0, sizeof value);
+  }
+
+  //! Writes a new value. It must be called always from the same thread.
+  void store(const T& new_value)
+  {
+    const uint32_t current = sequence.load(std::memory_order_relaxed);
+    sequence.store(current + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&value, &new_value, sizeof value);
+    sequence.store(current + 2, std::memory_order_release);
+  }
+
+  //! Returns a consistent copy of the value. It can be called from any thread.
+  T load() const
+  {
+    T copy;
+    uint32_t before, after;
+    do
+    {
+      before = sequence.load(std::memory_order_acquire);
+      memcpy(&copy, &value, sizeof copy);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+    return copy;
+  }
+};
+#endif
@@ -0,0 +1,179 @@
+/*!*******************************************************************************************
+ *  \file       tracer.h
+ *  \brief      Tracer definition file.
+ *  \details    This file contains the Tracer declaration and the tracing macros. To obtain more
+ *              information about it's definition consult the tracer.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef TRACER
+#define TRACER
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#include <time.h>
+
+/*!********************************************************************************************************************
+ *  \class      Tracer
+ *  \brief      Low overhead recorder of the time spent in the scopes of a process.
+ *  \details    Every thread writes its events in its own ring buffer without locks, so recording an event costs
+ *              two reads of the time stamp counter and a few stores. When a buffer is full the oldest events are
+ *              overwritten. Buffers are taken from a pool filled when tracing is enabled and returned to it when
+ *              their threads have finished and their events have been written. The events of every thread can be
+ *              written as a Chrome trace JSON file, which can be opened with chrome://tracing or
+ *              https://ui.perfetto.dev; the Perfetto protobuf format is not written. Tracing is disabled by default;
+ *              while it is disabled the scopes only check an atomic flag.
+ *
+ *********************************************************************************************************************/
+class Tracer
+{
+public:
+  static const uint32_t DEFAULT_EVENTS_PER_THREAD = 16384;  //!< Default capacity of the buffer of every thread.
+  static const uint32_t DEFAULT_PREALLOCATED_BUFFERS = 16;  //!< Default buffers allocated when tracing is enabled.
+  static const uint32_t MAX_RETIRED_BUFFERS = 16;           //!< Buffers of finished threads kept until written.
+
+  /*!******************************************************************************************************************
+   * \brief Sets the size of the buffers and how many of them are allocated when tracing is enabled.
+   * \details The buffers taken from then on have the new capacity, while the ones in use keep theirs until their
+   * threads finish.
+   * \param events_per_thread     Capacity of the buffer of every thread, rounded up to a power of two.
+   * \param preallocated_buffers  Buffers allocated when tracing is enabled.
+   *******************************************************************************************************************/
+  static void configure(uint32_t events_per_thread, uint32_t preallocated_buffers);
+
+  /*!******************************************************************************************************************
+   * \brief Enables or disables the recording of events in every thread.
+   * \details Enabling it allocates the configured number of buffers, so the first event of the threads does not
+   * allocate unless there are more threads tracing.
+   *******************************************************************************************************************/
+  static void setEnabled(bool enabled);
+
+  /*!******************************************************************************************************************
+   * \brief Takes the buffer of the calling thread if tracing is enabled, instead of taking it with its first event.
+   * \details Threads executing real-time work call it when they start. The buffer of a thread is retired when the
+   * thread finishes and reused by new threads once its events have been written.
+   *******************************************************************************************************************/
+  static void registerThread();
+
+  //! Returns true if events are being recorded.
+  static bool isEnabled()
+  {
+    return enabled_flag().load(std::memory_order_relaxed);
+  }
+
+  /*!******************************************************************************************************************
+   * \brief Returns the current time in the units of the trace clock.
+   * \details The trace clock is the time stamp counter on x86 processors whose counter runs at a constant rate and
+   * does not stop in the sleep states (the constant_tsc and nonstop_tsc flags of /proc/cpuinfo), and CLOCK_MONOTONIC
+   * in nanoseconds on the rest. Its values are converted to CLOCK_MONOTONIC time when the trace is written.
+   *******************************************************************************************************************/
+  static int64_t now()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool use_time_stamp_counter = hasInvariantTimeStampCounter();
+    if (use_time_stamp_counter)
+      return static_cast<int64_t>(__builtin_ia32_rdtsc());
+#endif
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+  }
+
+  /*!******************************************************************************************************************
+   * \brief Records a scope of the calling thread.
+   * \param name     Name of the scope. It is stored as a pointer, so it must be a string literal.
+   * \param begin    Trace clock time at which the scope started.
+   * \param end      Trace clock time at which the scope finished.
+   *******************************************************************************************************************/
+  static void record(const char* name, int64_t begin, int64_t end);
+
+  /*!******************************************************************************************************************
+   * \brief Writes the events of every thread to a file in Chrome trace JSON format.
+   * \details Events recorded while the file is being written may be missing or incomplete.
+   * \return False if the file could not be written.
+   *******************************************************************************************************************/
+  static bool writeChromeTrace(const std::string& path);
+
+private:
+  //! Returns true if the CPU flags show that the time stamp counter can measure time.
+  static bool hasInvariantTimeStampCounter();
+
+  static std::atomic<bool>& enabled_flag()
+  {
+    static std::atomic<bool> enabled(false);
+    return enabled;
+  }
+};
+
+/*!********************************************************************************************************************
+ *  \class      TraceScope
+ *  \brief      Records the lifetime of the object as a scope of the Tracer.
+ *
+ *********************************************************************************************************************/
+class TraceScope
+{
+private:
+  const char* name;  //!< Name of the scope, nullptr if tracing was disabled when the scope started.
+  int64_t begin;     //!< Trace clock time at which the scope started.
+
+public:
+  explicit TraceScope(const char* scope_name) : name(nullptr), begin(0)
+  {
+    if (Tracer::isEnabled())
+    {
+      name = scope_name;
+      begin = Tracer::now();
+    }
+  }
+
+  ~TraceScope()
+  {
+    if (name != nullptr)
+      Tracer::record(name, begin, Tracer::now());
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#define ROBOT_PROCESS_TRACE_CONCAT_IMPL(a, b) a##b
+#define ROBOT_PROCESS_TRACE_CONCAT(a, b) ROBOT_PROCESS_TRACE_CONCAT_IMPL(a, b)
+
+//! Records the rest of the enclosing scope with the given name, which must be a string literal.
+#define ROBOT_PROCESS_TRACE_SCOPE(name) TraceScope ROBOT_PROCESS_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+//! Records the rest of the enclosing function with its name.
+#define ROBOT_PROCESS_TRACE_FUNCTION() ROBOT_PROCESS_TRACE_SCOPE(__func__)
+
+#endif
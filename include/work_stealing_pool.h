@@ -0,0 +1,342 @@
+/*!*******************************************************************************************
+ *  \file       work_stealing_pool.h
+ *  \brief      WorkStealingPool definition file.
+ *  \details    This file contains the WorkStealingPool declaration. To obtain more information
+ *              about it's definition consult the work_stealing_pool.cpp file.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All rights reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#ifndef WORK_STEALING_POOL
+#define WORK_STEALING_POOL
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <stddef.h>
+
+/*!********************************************************************************************************************
+ *  \class      WorkStealingPool
+ *  \brief      Pool of threads executing short tasks, with a queue per thread and work stealing.
+ *  \details    Tasks submitted by a thread of the pool go to its own queue, and the rest are distributed among the
+ *              queues in turn. Every thread executes the newest task of its own queue and, when it is empty, steals
+ *              the oldest task of the other queues. A thread waiting for a TaskGroup executes pending tasks while
+ *              it waits, so groups can be nested, and sleeps when only tasks being executed by other threads are
+ *              left. While the pool is parked idle threads sleep immediately instead of spinning for a while. A pool
+ *              without threads executes the tasks in the submitting thread.
+ *              Submitting does not allocate memory: the queues are rings of QUEUE_CAPACITY preallocated slots, and
+ *              the tasks are stored in the slots when they fit in Task::INLINE_SIZE bytes, which is the case of the
+ *              chunks of parallelFor(). A task submitted to a full queue is executed in the submitting thread.
+ *
+ *********************************************************************************************************************/
+class WorkStealingPool
+{
+public:
+  static const size_t QUEUE_CAPACITY = 256;  //!< Slots of the queue of every thread.
+
+  /*!******************************************************************************************************************
+   *  \class      Task
+   *  \brief      Callable object stored without allocation when it fits in INLINE_SIZE bytes.
+   *  \details    Larger callables, or callables whose move constructor can throw, are allocated in the heap.
+   *******************************************************************************************************************/
+  class Task
+  {
+  public:
+    static const size_t INLINE_SIZE = 48;  //!< Bytes available for the callable inside the task.
+
+  private:
+    typedef typename std::aligned_storage<INLINE_SIZE>::type Storage;
+
+    Storage storage;                          //!< Callable, or pointer to it if it does not fit.
+    void (*invoke_function)(void*);           //!< Calls the callable.
+    void (*relocate_function)(void*, void*);  //!< Moves the callable to another storage, or destroys it if null.
+
+    template <class Function>
+    static void invokeInline(void* storage)
+    {
+      (*static_cast<Function*>(storage))();
+    }
+
+    template <class Function>
+    static void relocateInline(void* from, void* to)
+    {
+      if (to != nullptr)
+        new (to) Function(std::move(*static_cast<Function*>(from)));
+      static_cast<Function*>(from)->~Function();
+    }
+
+    template <class Function>
+    static void invokeAllocated(void* storage)
+    {
+      (**static_cast<Function**>(storage))();
+    }
+
+    template <class Function>
+    static void relocateAllocated(void* from, void* to)
+    {
+      if (to != nullptr)
+        *static_cast<Function**>(to) = *static_cast<Function**>(from);
+      else
+        delete *static_cast<Function**>(from);
+    }
+
+    template <class Function>
+    void store(Function&& function, std::true_type /* fits */)
+    {
+      typedef typename std::decay<Function>::type Stored;
+      new (&storage) Stored(std::forward<Function>(function));
+      invoke_function = &invokeInline<Stored>;
+      relocate_function = &relocateInline<Stored>;
+    }
+
+    template <class Function>
+    void store(Function&& function, std::false_type /* fits */)
+    {
+      typedef typename std::decay<Function>::type Stored;
+      *reinterpret_cast<Stored**>(&storage) = new Stored(std::forward<Function>(function));
+      invoke_function = &invokeAllocated<Stored>;
+      relocate_function = &relocateAllocated<Stored>;
+    }
+
+  public:
+    Task() : invoke_function(nullptr), relocate_function(nullptr)
+    {
+    }
+
+    template <class Function>
+    explicit Task(Function&& function)
+    {
+      typedef typename std::decay<Function>::type Stored;
+      static const bool fits = sizeof(Stored) <= INLINE_SIZE && alignof(Stored) <= alignof(Storage) &&
+                               std::is_nothrow_move_constructible<Stored>::value;
+      store(std::forward<Function>(function), std::integral_constant<bool, fits>());
+    }
+
+    Task(Task&& other) : invoke_function(other.invoke_function), relocate_function(other.relocate_function)
+    {
+      if (relocate_function != nullptr)
+        relocate_function(&other.storage, &storage);
+      other.invoke_function = nullptr;
+      other.relocate_function = nullptr;
+    }
+
+    Task& operator=(Task&& other)
+    {
+      if (this != &other)
+      {
+        reset();
+        invoke_function = other.invoke_function;
+        relocate_function = other.relocate_function;
+        if (relocate_function != nullptr)
+          relocate_function(&other.storage, &storage);
+        other.invoke_function = nullptr;
+        other.relocate_function = nullptr;
+      }
+      return *this;
+    }
+
+    ~Task()
+    {
+      reset();
+    }
+
+    //! Destroys the callable.
+    void reset()
+    {
+      if (relocate_function != nullptr)
+        relocate_function(&storage, nullptr);
+      invoke_function = nullptr;
+      relocate_function = nullptr;
+    }
+
+    //! Calls the callable.
+    void operator()()
+    {
+      invoke_function(&storage);
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+  };
+
+private:
+  struct Queue;
+
+public:
+  /*!******************************************************************************************************************
+   *  \class      TaskGroup
+   *  \brief      Set of tasks of a WorkStealingPool that can be waited for.
+   *******************************************************************************************************************/
+  class TaskGroup
+  {
+  private:
+    WorkStealingPool& pool;        //!< Pool executing the tasks.
+    std::atomic<size_t> pending;   //!< Tasks submitted and not finished.
+
+    friend class WorkStealingPool;
+
+  public:
+    explicit TaskGroup(WorkStealingPool& task_pool) : pool(task_pool), pending(0)
+    {
+    }
+
+    //! Waits for the tasks of the group.
+    ~TaskGroup()
+    {
+      wait();
+    }
+
+    //! Submits a task to the pool.
+    template <class Function>
+    void run(Function&& task)
+    {
+      pool.submit(std::forward<Function>(task), this);
+    }
+
+    //! Executes pending tasks of the pool until every task of the group has finished.
+    void wait()
+    {
+      pool.waitFor(*this);
+    }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+  };
+
+private:
+  //! Task queued in the pool.
+  struct Job
+  {
+    Task function;     //!< Task to execute.
+    TaskGroup* group;  //!< Group of the task.
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues;  //!< One queue per thread.
+  std::vector<std::thread> workers;            //!< Threads of the pool.
+  std::atomic<size_t> next_queue;              //!< Queue of the next task submitted from outside the pool.
+  std::atomic<size_t> queued_jobs;             //!< Tasks waiting in the queues.
+  std::atomic<int> sleeping_workers;           //!< Threads waiting for tasks.
+  std::atomic<bool> parked;                    //!< Idle threads sleep without spinning while true.
+  std::atomic<bool> active;                    //!< Keeps the threads alive while true.
+  std::mutex idle_mutex;                       //!< Mutex of the idle condition.
+  std::condition_variable idle_condition;      //!< Wakes up the sleeping threads.
+
+public:
+  //! Constructor.
+  WorkStealingPool();
+
+  //! Stops the threads.
+  ~WorkStealingPool();
+
+  //! Creates the threads of the pool. Pending tasks of a previous start() are discarded.
+  void start(unsigned int threads);
+
+  //! Stops and joins the threads. Tasks still queued are not executed.
+  void stop();
+
+  //! Returns the number of threads of the pool.
+  unsigned int threadCount() const
+  {
+    return static_cast<unsigned int>(workers.size());
+  }
+
+  //! Parks or unparks the threads of the pool.
+  void setParked(bool park)
+  {
+    parked.store(park, std::memory_order_relaxed);
+  }
+
+  /*!******************************************************************************************************************
+   * \brief Calls 'function(i)' for every i in [begin, end) using the threads of the pool and the calling thread.
+   * \details The range is divided in chunks of 'grain' indexes, or in four chunks per thread if 'grain' is 0. The
+   * function returns when every call has finished.
+   *******************************************************************************************************************/
+  template <class Function>
+  void parallelFor(size_t begin, size_t end, const Function& function, size_t grain = 0)
+  {
+    if (begin >= end)
+      return;
+    if (grain == 0)
+      grain = std::max<size_t>(1, (end - begin) / (4 * (threadCount() + 1)));
+
+    TaskGroup group(*this);
+    for (size_t chunk_begin = begin; chunk_begin < end; chunk_begin += grain)
+    {
+      const size_t chunk_end = std::min(end, chunk_begin + grain);
+      group.run([&function, chunk_begin, chunk_end]() {
+        for (size_t i = chunk_begin; i < chunk_end; i++)
+          function(i);
+      });
+    }
+    group.wait();
+  }
+
+private:
+  //! Queues a task of a group, or executes it if the pool has no threads.
+  template <class Function>
+  void submit(Function&& task, TaskGroup* group)
+  {
+    if (workers.empty())
+    {
+      task();
+      return;
+    }
+    Job job{ Task(std::forward<Function>(task)), group };
+    submit(job);
+  }
+
+  //! Queues a task, or executes it if the queue is full.
+  void submit(Job& job);
+
+  //! Executes pending tasks until the group has finished, sleeping when none is left to execute.
+  void waitFor(TaskGroup& group);
+
+  //! Takes a task, from the queue 'own' first and from the others after. Returns false if there is none.
+  bool takeJob(size_t own, Job& job);
+
+  //! Executes a task and updates its group, waking up its waiting thread when it is the last one.
+  void execute(Job& job);
+
+  //! Loop of the threads of the pool.
+  void worker(size_t index);
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+};
+#endif
@@ -0,0 +1,136 @@
+/*!*******************************************************************************************
+ *  \file       allocation_hooks.cpp
+ *  \brief      Replacement of the global allocation functions.
+ *  \details    This file replaces the global operator new and operator delete to count the
+ *              allocations in the AllocationProfiler. It is only compiled with the CMake option
+ *              ROBOT_PROCESS_ALLOC_PROFILER.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/allocation_profiler.h"
+
+#include <new>
+#include <stdlib.h>
+
+// glibc removed __malloc_hook and the rest of the malloc hooks in version 2.34, so the allocations are counted in the
+// C++ allocation functions only. Direct calls to malloc() are not counted.
+
+namespace
+{
+void* allocate(size_t bytes)
+{
+  AllocationProfiler::recordAllocation(bytes);
+  if (bytes == 0)
+    bytes = 1;
+  for (;;)
+  {
+    void* pointer = malloc(bytes);
+    if (pointer != nullptr)
+      return pointer;
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr)
+      throw std::bad_alloc();
+    handler();
+  }
+}
+
+void* allocateNoThrow(size_t bytes) noexcept
+{
+  try
+  {
+    return allocate(bytes);
+  }
+  catch (...)
+  {
+    return nullptr;
+  }
+}
+
+void deallocate(void* pointer) noexcept
+{
+  if (pointer == nullptr)
+    return;
+  AllocationProfiler::recordDeallocation();
+  free(pointer);
+}
+}  // namespace
+
+void* operator new(size_t bytes)
+{
+  return allocate(bytes);
+}
+
+void* operator new[](size_t bytes)
+{
+  return allocate(bytes);
+}
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept
+{
+  return allocateNoThrow(bytes);
+}
+
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept
+{
+  return allocateNoThrow(bytes);
+}
+
+void operator delete(void* pointer) noexcept
+{
+  deallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+  deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+  deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+  deallocate(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+  deallocate(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+  deallocate(pointer);
+}
@@ -0,0 +1,170 @@
+/*!*******************************************************************************************
+ *  \file       allocation_profiler.cpp
+ *  \brief      AllocationProfiler implementation file.
+ *  \details    This file implements the AllocationProfiler class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/allocation_profiler.h"
+
+#include <atomic>
+#include <execinfo.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace
+{
+struct PhaseCounters
+{
+  std::atomic<uint64_t> allocations;
+  std::atomic<uint64_t> bytes;
+  std::atomic<uint64_t> deallocations;
+};
+
+// Zero initialized before any constructor runs, so allocations of static constructors are counted too.
+PhaseCounters counters[AllocationProfiler::PHASE_COUNT];
+
+std::atomic<uint8_t> strict_mode(0);
+std::atomic<uint64_t> warmup_cycles(0);
+std::atomic<uint64_t> run_cycles(0);
+std::atomic<bool> strict_armed(false);
+std::atomic<bool> strict_reported(false);
+
+thread_local AllocationPhase thread_phase = AllocationPhase::OTHER;
+
+const char* const PHASE_NAMES[AllocationProfiler::PHASE_COUNT] = { "other", "setUp", "ownStart", "ownRun",
+                                                                   "callbacks" };
+
+const int BACKTRACE_DEPTH = 64;
+
+// Only uses functions that do not allocate, since it is called from operator new.
+void writeError(const char* text)
+{
+  ssize_t result = write(STDERR_FILENO, text, strlen(text));
+  (void)result;
+}
+
+void reportAllocation()
+{
+  AllocationProfiler::StrictMode mode = static_cast<AllocationProfiler::StrictMode>(strict_mode.load());
+  if (mode == AllocationProfiler::StrictMode::ABORT)
+  {
+    writeError("robot_process: memory allocated inside ownRun(), aborting\n");
+    abort();
+  }
+  if (strict_reported.exchange(true))
+    return;
+
+  // Allocations made while reporting, if any, are attributed to the OTHER phase.
+  const AllocationPhase previous = AllocationProfiler::exchangePhase(AllocationPhase::OTHER);
+  void* frames[BACKTRACE_DEPTH];
+  const int depth = backtrace(frames, BACKTRACE_DEPTH);
+  writeError("robot_process: memory allocated inside ownRun() after the warm-up, backtrace:\n");
+  backtrace_symbols_fd(frames, depth, STDERR_FILENO);
+  AllocationProfiler::exchangePhase(previous);
+}
+}  // namespace
+
+bool AllocationProfiler::isAvailable()
+{
+#ifdef ROBOT_PROCESS_ALLOC_PROFILER
+  return true;
+#else
+  return false;
+#endif
+}
+
+void AllocationProfiler::setStrictMode(StrictMode mode, uint64_t warmup)
+{
+  // backtrace() loads libgcc the first time it is called, which allocates. It is done here, out of ownRun().
+  void* frames[1];
+  backtrace(frames, 1);
+
+  warmup_cycles = warmup;
+  run_cycles = 0;
+  strict_reported = false;
+  strict_armed = false;
+  strict_mode = static_cast<uint8_t>(mode);
+}
+
+void AllocationProfiler::countRunCycle()
+{
+  if (strict_mode.load(std::memory_order_relaxed) != static_cast<uint8_t>(StrictMode::OFF) &&
+      !strict_armed.load(std::memory_order_relaxed) &&
+      run_cycles.fetch_add(1, std::memory_order_relaxed) + 1 >= warmup_cycles.load(std::memory_order_relaxed))
+    strict_armed.store(true, std::memory_order_relaxed);
+}
+
+AllocationProfiler::PhaseStatistics AllocationProfiler::getStatistics(AllocationPhase phase)
+{
+  const PhaseCounters& phase_counters = counters[static_cast<int>(phase)];
+  PhaseStatistics statistics;
+  statistics.allocations = phase_counters.allocations.load(std::memory_order_relaxed);
+  statistics.bytes = phase_counters.bytes.load(std::memory_order_relaxed);
+  statistics.deallocations = phase_counters.deallocations.load(std::memory_order_relaxed);
+  return statistics;
+}
+
+const char* AllocationProfiler::phaseName(AllocationPhase phase)
+{
+  return PHASE_NAMES[static_cast<int>(phase)];
+}
+
+AllocationPhase AllocationProfiler::currentPhase()
+{
+  return thread_phase;
+}
+
+AllocationPhase AllocationProfiler::exchangePhase(AllocationPhase phase)
+{
+  const AllocationPhase previous = thread_phase;
+  thread_phase = phase;
+  return previous;
+}
+
+void AllocationProfiler::recordAllocation(size_t bytes)
+{
+  const AllocationPhase phase = thread_phase;
+  PhaseCounters& phase_counters = counters[static_cast<int>(phase)];
+  phase_counters.allocations.fetch_add(1, std::memory_order_relaxed);
+  phase_counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+  if (phase == AllocationPhase::RUN && strict_armed.load(std::memory_order_relaxed))
+    reportAllocation();
+}
+
+void AllocationProfiler::recordDeallocation()
+{
+  counters[static_cast<int>(thread_phase)].deallocations.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,125 @@
+/*!*******************************************************************************************
+ *  \file       cycle_arena.cpp
+ *  \brief      CycleArena implementation file.
+ *  \details    This file implements the CycleArena class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/cycle_arena.h"
+
+#include <algorithm>
+#include <new>
+
+namespace
+{
+const size_t MINIMUM_CHUNK_BYTES = 64 * 1024;  // Size of the chunks taken from the heap when the arena is exhausted.
+}  // namespace
+
+CycleArena::CycleArena()
+  : current_chunk(0)
+  , position(nullptr)
+  , limit(nullptr)
+  , used_before_chunk(0)
+  , capacity(0)
+  , high_water(0)
+  , total_high_water(0)
+{
+}
+
+CycleArena::~CycleArena()
+{
+  for (const Chunk& chunk : chunks)
+    ::operator delete(chunk.memory);
+}
+
+void CycleArena::reserve(size_t bytes)
+{
+  if (!chunks.empty() || bytes == 0)
+    return;
+  chunks.push_back(Chunk{ static_cast<char*>(::operator new(bytes)), bytes });
+  capacity.store(bytes, std::memory_order_relaxed);
+  useChunk(0);
+}
+
+void CycleArena::useChunk(size_t index)
+{
+  current_chunk = index;
+  position = chunks[index].memory;
+  limit = chunks[index].memory + chunks[index].size;
+}
+
+void* CycleArena::allocateFromNextChunk(size_t bytes, size_t alignment)
+{
+  if (!chunks.empty())
+    used_before_chunk += position - chunks[current_chunk].memory;
+
+  // Chunks kept from previous cycles are reused first.
+  for (size_t index = chunks.empty() ? 0 : current_chunk + 1; index < chunks.size(); index++)
+  {
+    if (chunks[index].size >= bytes + alignment)
+    {
+      useChunk(index);
+      return allocate(bytes, alignment);
+    }
+  }
+
+  // The chunks are at least doubled, so the number of chunks grows logarithmically with the memory used.
+  size_t size = std::max(bytes + alignment, MINIMUM_CHUNK_BYTES);
+  if (!chunks.empty())
+    size = std::max(size, 2 * chunks.back().size);
+  chunks.push_back(Chunk{ static_cast<char*>(::operator new(size)), size });
+  capacity.store(capacity.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+  useChunk(chunks.size() - 1);
+  return allocate(bytes, alignment);
+}
+
+size_t CycleArena::used() const
+{
+  return chunks.empty() ? 0 : used_before_chunk + (position - chunks[current_chunk].memory);
+}
+
+void CycleArena::reset()
+{
+  const size_t cycle_bytes = used();
+  if (cycle_bytes > total_high_water.load(std::memory_order_relaxed))
+    total_high_water.store(cycle_bytes, std::memory_order_relaxed);
+  size_t period_bytes = high_water.load(std::memory_order_relaxed);
+  while (cycle_bytes > period_bytes &&
+         !high_water.compare_exchange_weak(period_bytes, cycle_bytes, std::memory_order_relaxed))
+  {
+  }
+
+  used_before_chunk = 0;
+  if (!chunks.empty())
+    useChunk(0);
+}
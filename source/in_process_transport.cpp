@@ -0,0 +1,253 @@
+/*!*******************************************************************************************
+ *  \file       in_process_transport.cpp
+ *  \brief      InProcessTransport implementation file.
+ *  \details    This file implements the InProcessTransport class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/in_process_transport.h"
+
+namespace
+{
+template <class T>
+void lookUp(const std::map<std::string, T>& params, const std::string& name, T& value, const T& default_value)
+{
+  typename std::map<std::string, T>::const_iterator param = params.find(name);
+  value = param != params.end() ? param->second : default_value;
+}
+}  // namespace
+
+InProcessTransport::InProcessTransport(const std::string& process_name)
+  : name(process_name), serving(false), active_requests(0), shut_down(false)
+{
+}
+
+void InProcessTransport::setParam(const std::string& param_name, bool value)
+{
+  bool_params[param_name] = value;
+}
+
+void InProcessTransport::setParam(const std::string& param_name, int value)
+{
+  int_params[param_name] = value;
+}
+
+void InProcessTransport::setParam(const std::string& param_name, double value)
+{
+  double_params[param_name] = value;
+}
+
+void InProcessTransport::setParam(const std::string& param_name, const std::string& value)
+{
+  string_params[param_name] = value;
+}
+
+void InProcessTransport::setParam(const std::string& param_name, const char* value)
+{
+  string_params[param_name] = value;
+}
+
+void InProcessTransport::setParam(const std::string& param_name, const std::vector<int>& value)
+{
+  vector_params[param_name] = value;
+}
+
+void InProcessTransport::setStateChangeListener(const std::function<void(const ProcessStateChange&)>& listener)
+{
+  state_change_listener = listener;
+}
+
+void InProcessTransport::setHeartbeatListener(const std::function<void(const ProcessHeartbeatInfo&)>& listener)
+{
+  heartbeat_listener = listener;
+}
+
+void InProcessTransport::setMetricsListener(const std::function<void(const ProcessMetrics&)>& listener)
+{
+  metrics_listener = listener;
+}
+
+template <class Result>
+Result InProcessTransport::callHandler(std::function<Result()> ProcessRequestHandlers::*member,
+                                       const Result& not_served)
+{
+  std::function<Result()> handler;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!serving || !(handlers.*member))
+      return not_served;
+    handler = handlers.*member;
+    active_requests++;
+  }
+
+  struct RequestScope
+  {
+    InProcessTransport* transport;
+    ~RequestScope()
+    {
+      transport->finishRequest();
+    }
+  } scope = { this };
+  return handler();
+}
+
+void InProcessTransport::finishRequest()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (--active_requests == 0)
+    requests_condition.notify_all();
+}
+
+bool InProcessTransport::requestStart()
+{
+  return callHandler(&ProcessRequestHandlers::start, false);
+}
+
+bool InProcessTransport::requestStop()
+{
+  return callHandler(&ProcessRequestHandlers::stop, false);
+}
+
+bool InProcessTransport::requestPause()
+{
+  return callHandler(&ProcessRequestHandlers::pause, false);
+}
+
+bool InProcessTransport::requestResume()
+{
+  return callHandler(&ProcessRequestHandlers::resume, false);
+}
+
+bool InProcessTransport::requestDumpTrace()
+{
+  return callHandler(&ProcessRequestHandlers::dump_trace, false);
+}
+
+ProcessStatus InProcessTransport::requestStatus()
+{
+  ProcessStatus not_served = ProcessStatus();
+  not_served.state = ProcessState::CREATED;
+  return callHandler(&ProcessRequestHandlers::get_status, not_served);
+}
+
+void InProcessTransport::requestShutdown()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    shut_down = true;
+  }
+  condition.notify_all();
+}
+
+std::string InProcessTransport::processName() const
+{
+  return name;
+}
+
+void InProcessTransport::param(const std::string& param_name, bool& value, bool default_value)
+{
+  lookUp(bool_params, param_name, value, default_value);
+}
+
+void InProcessTransport::param(const std::string& param_name, int& value, int default_value)
+{
+  lookUp(int_params, param_name, value, default_value);
+}
+
+void InProcessTransport::param(const std::string& param_name, double& value, double default_value)
+{
+  lookUp(double_params, param_name, value, default_value);
+}
+
+void InProcessTransport::param(const std::string& param_name, std::string& value, const std::string& default_value)
+{
+  lookUp(string_params, param_name, value, default_value);
+}
+
+void InProcessTransport::param(const std::string& param_name, std::vector<int>& value,
+                               const std::vector<int>& default_value)
+{
+  lookUp(vector_params, param_name, value, default_value);
+}
+
+void InProcessTransport::advertise(const ProcessRequestHandlers& process_handlers)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  handlers = process_handlers;
+}
+
+void InProcessTransport::startServing(int)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  serving = true;
+}
+
+void InProcessTransport::shutdown()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  serving = false;
+  requests_condition.wait(lock, [this]() { return active_requests == 0; });
+}
+
+void InProcessTransport::publishStateChange(const ProcessStateChange& change)
+{
+  if (state_change_listener)
+    state_change_listener(change);
+}
+
+void InProcessTransport::publishHeartbeat(const ProcessHeartbeatInfo& heartbeat)
+{
+  if (heartbeat_listener)
+    heartbeat_listener(heartbeat);
+}
+
+void InProcessTransport::publishMetrics(const ProcessMetrics& metrics)
+{
+  if (metrics_listener)
+    metrics_listener(metrics);
+}
+
+bool InProcessTransport::ok() const
+{
+  return !shut_down.load(std::memory_order_relaxed);
+}
+
+void InProcessTransport::spinOnce()
+{
+}
+
+void InProcessTransport::spin()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  condition.wait(lock, [this]() { return shut_down.load(); });
+}
@@ -0,0 +1,89 @@
+/*!*******************************************************************************************
+ *  \file       latency_histogram.cpp
+ *  \brief      LatencyHistogram implementation file.
+ *  \details    This file implements the LatencyHistogram class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/latency_histogram.h"
+
+LatencyHistogram::LatencyHistogram() : max_value(0), total_count(0)
+{
+  for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+    buckets[i].store(0, std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::bucketHighestValue(uint32_t index)
+{
+  if (index < 2 * SUB_BUCKET_COUNT)
+    return index;
+
+  const uint32_t shift = index / SUB_BUCKET_COUNT - 1;
+  const int64_t lowest = static_cast<int64_t>(index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT) << shift;
+  return lowest + (static_cast<int64_t>(1) << shift) - 1;
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::takeSnapshot()
+{
+  // Values recorded while the buckets are being emptied are counted in this snapshot or in the next one.
+  uint64_t counts[BUCKET_COUNT];
+  Snapshot snapshot;
+  snapshot.count = 0;
+  for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+  {
+    counts[i] = buckets[i].exchange(0, std::memory_order_relaxed);
+    snapshot.count += counts[i];
+  }
+  snapshot.max = max_value.exchange(0, std::memory_order_relaxed);
+
+  const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+  int64_t* const results[] = { &snapshot.p50, &snapshot.p90, &snapshot.p99, &snapshot.p999 };
+  uint32_t bucket = 0;
+  uint64_t accumulated = 0;
+  for (int q = 0; q < 4; q++)
+  {
+    *results[q] = 0;
+    if (snapshot.count == 0)
+      continue;
+
+    uint64_t rank = static_cast<uint64_t>(quantiles[q] * snapshot.count + 0.5);
+    if (rank == 0)
+      rank = 1;
+    while (bucket < BUCKET_COUNT && accumulated + counts[bucket] < rank)
+      accumulated += counts[bucket++];
+
+    const int64_t value = bucket < BUCKET_COUNT ? bucketHighestValue(bucket) : snapshot.max;
+    *results[q] = value < snapshot.max ? value : snapshot.max;
+  }
+  return snapshot;
+}
@@ -0,0 +1,155 @@
+/*!*******************************************************************************************
+ *  \file       lockstep_coordinator.cpp
+ *  \brief      LockstepCoordinator implementation file.
+ *  \details    This file implements the LockstepCoordinator class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+
+#include "../include/lockstep_coordinator.h"
+
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+// Reads of the board done without sleeping, first spinning and then yielding the processor.
+const uint32_t SPIN_ATTEMPTS = 1000;
+const uint32_t YIELD_ATTEMPTS = 100;
+
+// Sleep between reads once the process is waiting for a slow tick.
+const useconds_t POLL_PERIOD_US = 50;
+
+int64_t monotonicNow()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+bool waitsForTick(const ProcessStateBoard::Entry& entry, int64_t tick_ns)
+{
+  return entry.completed_tick_ns < tick_ns && ProcessStateBoard::isAlive(entry.pid);
+}
+}  // namespace
+
+LockstepCoordinator::LockstepCoordinator(const std::string& host, const std::string& lockstep_group)
+  : hostname(host), group(lockstep_group)
+{
+  if (hostname.empty())
+  {
+    char buf[32];
+    gethostname(buf, sizeof buf);
+    hostname.append(buf);
+  }
+}
+
+bool LockstepCoordinator::readBoard()
+{
+  if (!board.isAttached() && !board.attach(hostname))
+  {
+    entries.clear();
+    return false;
+  }
+  return board.readEntries(entries);
+}
+
+size_t LockstepCoordinator::countParticipants()
+{
+  readBoard();
+  size_t participants = 0;
+  for (const ProcessStateBoard::Entry& entry : entries)
+  {
+    if (participates(entry))
+      participants++;
+  }
+  return participants;
+}
+
+bool LockstepCoordinator::waitForParticipants(size_t count, int64_t timeout_ns)
+{
+  return waitFor([this, count]() { return countParticipants() >= count; }, timeout_ns);
+}
+
+bool LockstepCoordinator::waitForTick(int64_t tick_ns, int64_t timeout_ns)
+{
+  return waitFor([this, tick_ns]() { return readBoard() && tickCompleted(tick_ns); }, timeout_ns);
+}
+
+std::vector<std::string> LockstepCoordinator::pendingParticipants(int64_t tick_ns)
+{
+  std::vector<std::string> pending;
+  readBoard();
+  for (const ProcessStateBoard::Entry& entry : entries)
+  {
+    if (participates(entry) && waitsForTick(entry, tick_ns))
+      pending.push_back(entry.name);
+  }
+  return pending;
+}
+
+bool LockstepCoordinator::tickCompleted(int64_t tick_ns) const
+{
+  for (const ProcessStateBoard::Entry& entry : entries)
+  {
+    if (participates(entry) && waitsForTick(entry, tick_ns))
+      return false;
+  }
+  return true;
+}
+
+bool LockstepCoordinator::participates(const ProcessStateBoard::Entry& entry) const
+{
+  return entry.lockstep && strncmp(entry.lockstep_group, group.c_str(), ProcessStateBoard::GROUP_LENGTH) == 0;
+}
+
+bool LockstepCoordinator::waitFor(const std::function<bool()>& condition, int64_t timeout_ns)
+{
+  const int64_t deadline_ns = monotonicNow() + timeout_ns;
+  for (uint32_t attempt = 0;; attempt++)
+  {
+    if (condition())
+      return true;
+    if (monotonicNow() >= deadline_ns)
+      return false;
+
+    if (attempt < SPIN_ATTEMPTS)
+      continue;
+    else if (attempt < SPIN_ATTEMPTS + YIELD_ATTEMPTS)
+      sched_yield();
+    else
+      usleep(POLL_PERIOD_US);
+  }
+}
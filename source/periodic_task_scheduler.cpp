@@ -0,0 +1,246 @@
+/*!*******************************************************************************************
+ *  \file       periodic_task_scheduler.cpp
+ *  \brief      PeriodicTaskScheduler implementation file.
+ *  \details    This file implements the PeriodicTaskScheduler class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/periodic_task_scheduler.h"
+#include "../include/tracer.h"
+
+#include <algorithm>
+#include <limits>
+#include <time.h>
+
+namespace
+{
+int64_t monotonicNow()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+// Scheduler whose task is being executed by the current thread, so that waitForIdle() does not wait for itself.
+thread_local const PeriodicTaskScheduler* executing_scheduler = nullptr;
+}  // namespace
+
+PeriodicTaskScheduler::PeriodicTaskScheduler()
+  : running_tasks(0), active(false), enabled(false), clock(std::make_shared<RealClock>()), clock_listener(0)
+{
+}
+
+PeriodicTaskScheduler::~PeriodicTaskScheduler()
+{
+  stop();
+}
+
+PeriodicTaskScheduler::TaskId PeriodicTaskScheduler::addTask(const std::string& name, double rate,
+                                                             const std::function<void()>& function, int priority)
+{
+  if (rate <= 0)
+    return INVALID_TASK;
+
+  std::unique_ptr<Task> task(new Task());
+  task->statistics.name = name;
+  task->statistics.rate = rate;
+  task->statistics.priority = priority;
+  task->statistics.runs = 0;
+  task->statistics.overruns = 0;
+  task->statistics.last_duration_ns = 0;
+  task->statistics.max_duration_ns = 0;
+  task->statistics.mean_duration_ns = 0;
+  task->period_ns = static_cast<int64_t>(1e9 / rate);
+  task->function = function;
+  task->next_release_ns = 0;
+  task->total_duration_ns = 0;
+  task->running = false;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  tasks.push_back(std::move(task));
+  return static_cast<TaskId>(tasks.size() - 1);
+}
+
+bool PeriodicTaskScheduler::hasTasks() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return !tasks.empty();
+}
+
+void PeriodicTaskScheduler::setClock(const std::shared_ptr<ProcessClock>& task_clock)
+{
+  clock = task_clock;
+}
+
+void PeriodicTaskScheduler::start(unsigned int threads)
+{
+  stop();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    active = true;
+  }
+  clock_listener = clock->addAdvanceListener([this]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    condition.notify_all();
+  });
+  for (unsigned int i = 0; i < threads; i++)
+    workers.push_back(std::thread(&PeriodicTaskScheduler::worker, this));
+}
+
+void PeriodicTaskScheduler::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    active = false;
+  }
+  condition.notify_all();
+  for (std::thread& worker : workers)
+    worker.join();
+  workers.clear();
+  if (clock_listener != 0)
+  {
+    clock->removeAdvanceListener(clock_listener);
+    clock_listener = 0;
+  }
+}
+
+void PeriodicTaskScheduler::setEnabled(bool enable)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (enable && !enabled)
+    {
+      const int64_t now = clock->now();
+      for (std::unique_ptr<Task>& task : tasks)
+        task->next_release_ns = now;
+    }
+    enabled = enable;
+  }
+  condition.notify_all();
+}
+
+void PeriodicTaskScheduler::waitForIdle()
+{
+  const unsigned int own_tasks = executing_scheduler == this ? 1 : 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  idle_condition.wait(lock, [this, own_tasks]() { return running_tasks <= own_tasks; });
+}
+
+std::vector<PeriodicTaskScheduler::TaskStatistics> PeriodicTaskScheduler::getStatistics() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<TaskStatistics> statistics;
+  for (const std::unique_ptr<Task>& task : tasks)
+    statistics.push_back(task->statistics);
+  return statistics;
+}
+
+void PeriodicTaskScheduler::worker()
+{
+  Tracer::registerThread();
+  std::unique_lock<std::mutex> lock(mutex);
+  while (active)
+  {
+    if (!enabled)
+    {
+      condition.wait(lock);
+      continue;
+    }
+
+    // The task with the highest priority among the released ones. Ties are broken by rate, then by order of addition.
+    const int64_t now = clock->now();
+    Task* selected = nullptr;
+    int64_t next_release_ns = std::numeric_limits<int64_t>::max();
+    for (std::unique_ptr<Task>& task : tasks)
+    {
+      if (task->running)
+        continue;
+      if (task->next_release_ns > now)
+      {
+        next_release_ns = std::min(next_release_ns, task->next_release_ns);
+        continue;
+      }
+      if (selected == nullptr || task->statistics.priority > selected->statistics.priority ||
+          (task->statistics.priority == selected->statistics.priority && task->period_ns < selected->period_ns))
+        selected = task.get();
+    }
+
+    if (selected == nullptr)
+    {
+      if (next_release_ns == std::numeric_limits<int64_t>::max())
+        condition.wait(lock);
+      else
+        clock->waitUntil(lock, condition, next_release_ns);
+      continue;
+    }
+
+    selected->running = true;
+    running_tasks++;
+    const int64_t release_ns = selected->next_release_ns;
+    lock.unlock();
+
+    const int64_t start_ns = monotonicNow();
+    {
+      TraceScope trace(selected->statistics.name.c_str());
+      executing_scheduler = this;
+      selected->function();
+      executing_scheduler = nullptr;
+    }
+    const int64_t end_ns = monotonicNow();
+    const int64_t end_clock_ns = clock->now();
+
+    lock.lock();
+    selected->running = false;
+    running_tasks--;
+    idle_condition.notify_all();
+    // The idle workers ignored the task while it ran, so one of them is woken up to wait for its next release.
+    condition.notify_one();
+
+    TaskStatistics& statistics = selected->statistics;
+    const int64_t duration_ns = end_ns - start_ns;
+    statistics.runs++;
+    statistics.last_duration_ns = duration_ns;
+    statistics.max_duration_ns = std::max(statistics.max_duration_ns, duration_ns);
+    selected->total_duration_ns += duration_ns;
+    statistics.mean_duration_ns = selected->total_duration_ns / static_cast<int64_t>(statistics.runs);
+
+    // The next release keeps the phase of the task even if some periods have to be skipped.
+    selected->next_release_ns = release_ns + selected->period_ns;
+    if (selected->next_release_ns <= end_clock_ns)
+    {
+      const int64_t skipped = (end_clock_ns - selected->next_release_ns) / selected->period_ns + 1;
+      statistics.overruns += skipped;
+      selected->next_release_ns += skipped * selected->period_ns;
+    }
+  }
+}
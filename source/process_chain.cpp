@@ -0,0 +1,183 @@
+/*!*******************************************************************************************
+ *  \file       process_chain.cpp
+ *  \brief      ProcessChain implementation file.
+ *  \details    This file implements the ProcessChain class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/process_chain.h"
+#include "../include/ros_transport.h"
+#include "../include/run_executor.h"
+
+#include <algorithm>
+
+namespace
+{
+// Ports of every process, so a chain can find the ones of its stages.
+std::mutex ports_mutex;
+std::vector<ChainPort*> ports;
+}  // namespace
+
+ChainPort::ChainPort() : owner(nullptr), type(nullptr)
+{
+}
+
+ChainPort::~ChainPort()
+{
+  std::lock_guard<std::mutex> lock(ports_mutex);
+  ports.erase(std::remove(ports.begin(), ports.end(), this), ports.end());
+}
+
+bool ChainPort::registerPort(RobotProcess& process, const std::string& port_topic, const std::type_info& message_type)
+{
+  const std::shared_ptr<RosTransport> ros_transport = std::dynamic_pointer_cast<RosTransport>(process.getTransport());
+  const bool connected = ros_transport != nullptr;
+  const std::string resolved_topic = connected ? ros_transport->nodeHandle().resolveName(port_topic) : port_topic;
+
+  std::lock_guard<std::mutex> lock(ports_mutex);
+  if (owner == nullptr)
+    ports.push_back(this);
+  owner = &process;
+  topic = resolved_topic;
+  type = &message_type;
+  return connected;
+}
+
+ros::NodeHandle ChainPort::nodeHandle(RobotProcess& process)
+{
+  return std::static_pointer_cast<RosTransport>(process.getTransport())->nodeHandle();
+}
+
+std::vector<ChainPort*> ChainPort::portsOf(const RobotProcess& process)
+{
+  std::lock_guard<std::mutex> lock(ports_mutex);
+  std::vector<ChainPort*> process_ports;
+  for (ChainPort* port : ports)
+  {
+    if (port->owner == &process)
+      process_ports.push_back(port);
+  }
+  return process_ports;
+}
+
+ProcessChain::ProcessChain(const std::string& chain_name) : name(chain_name)
+{
+}
+
+ProcessChain::~ProcessChain()
+{
+  unfuse();
+}
+
+void ProcessChain::addStage(RobotProcess& process)
+{
+  stages.push_back(&process);
+}
+
+size_t ProcessChain::fuse()
+{
+  unfuse();
+  for (size_t producer = 0; producer < stages.size(); producer++)
+  {
+    for (ChainPort* output : ChainPort::portsOf(*stages[producer]))
+    {
+      if (!output->isOutput())
+        continue;
+
+      for (size_t consumer = producer + 1; consumer < stages.size(); consumer++)
+      {
+        for (ChainPort* input : ChainPort::portsOf(*stages[consumer]))
+        {
+          if (input->isOutput() || input->topic != output->topic || *input->type != *output->type)
+            continue;
+
+          output->fuse(*input);
+          input->setFused(true);
+          fused_ports.push_back(std::make_pair(output, input));
+        }
+      }
+    }
+  }
+  return fused_ports.size();
+}
+
+void ProcessChain::unfuse()
+{
+  for (const std::pair<ChainPort*, ChainPort*>& fused : fused_ports)
+  {
+    fused.first->unfuse(*fused.second);
+    fused.second->setFused(false);
+  }
+  fused_ports.clear();
+}
+
+void ProcessChain::run()
+{
+  for (RobotProcess* stage : stages)
+  {
+    stage->getTransport()->spinOnce();
+    stage->run();
+  }
+}
+
+void ProcessChain::runAtRate(double rate)
+{
+  if (stages.empty() || rate <= 0)
+    return;
+
+  for (size_t i = 1; i < stages.size(); i++)
+    stages[i]->beginScheduledRuns(rate);
+
+  // The first stage is executed by its own loop, which serves its callbacks, and the rest follow it.
+  RobotProcess& first = *stages.front();
+  first.runCyclesAtRate(rate, [this, &first]() {
+    first.run();
+    runStages(1, first.cycle_release_ns);
+  });
+}
+
+uint32_t ProcessChain::addTo(RunExecutor& executor, double rate)
+{
+  if (rate <= 0)
+    return RunExecutor::INVALID_JOB;
+
+  for (RobotProcess* stage : stages)
+    stage->beginScheduledRuns(rate);
+  return executor.addReleasedJob(name, rate, [this](int64_t release_ns) { runStages(0, release_ns); });
+}
+
+void ProcessChain::runStages(size_t first_stage, int64_t release_ns)
+{
+  for (size_t i = first_stage; i < stages.size(); i++)
+    stages[i]->runScheduledCycle(release_ns);
+}
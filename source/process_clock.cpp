@@ -0,0 +1,238 @@
+/*!*******************************************************************************************
+ *  \file       process_clock.cpp
+ *  \brief      ProcessClock implementation file.
+ *  \details    This file implements the ProcessClock, RealClock and ManualClock classes.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+
+#include "../include/process_clock.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <errno.h>
+#include <time.h>
+
+namespace
+{
+const int64_t NANOSECONDS_PER_SECOND = 1000000000;
+
+// Longest real time that a simulated clock waits before returning control to the caller.
+const std::chrono::milliseconds MAX_SIMULATED_WAIT(100);
+
+// std::chrono::steady_clock uses CLOCK_MONOTONIC, so both share the same epoch.
+std::chrono::steady_clock::time_point toSteadyTime(int64_t monotonic_ns)
+{
+  return std::chrono::steady_clock::time_point(
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(monotonic_ns)));
+}
+}  // namespace
+
+int64_t RealClock::now() const
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * NANOSECONDS_PER_SECOND + now.tv_nsec;
+}
+
+bool RealClock::isSimulated() const
+{
+  return false;
+}
+
+bool RealClock::sleepUntil(int64_t deadline_ns)
+{
+  timespec deadline;
+  deadline.tv_sec = deadline_ns / NANOSECONDS_PER_SECOND;
+  deadline.tv_nsec = deadline_ns % NANOSECONDS_PER_SECOND;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+  {
+  }
+  return true;
+}
+
+void RealClock::waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition, int64_t deadline_ns)
+{
+  condition.wait_until(lock, toSteadyTime(deadline_ns));
+}
+
+ProcessClock::ListenerId RealClock::addAdvanceListener(const std::function<void()>&)
+{
+  return 0;
+}
+
+void RealClock::removeAdvanceListener(ListenerId)
+{
+}
+
+uint64_t RealClock::joinLockstep()
+{
+  return 0;
+}
+
+bool RealClock::waitForTick(uint64_t, uint64_t&)
+{
+  std::this_thread::sleep_for(MAX_SIMULATED_WAIT);
+  return false;
+}
+
+void RealClock::completeTick(uint64_t)
+{
+}
+
+void RealClock::leaveLockstep(uint64_t)
+{
+}
+
+ManualClock::ManualClock(int64_t start_ns)
+  : time_ns(start_ns), current_tick(0), lockstep_participants(0), pending_completions(0), next_listener(1)
+{
+}
+
+void ManualClock::step(int64_t duration_ns)
+{
+  advanceTo(now() + std::max(duration_ns, static_cast<int64_t>(0)));
+}
+
+void ManualClock::advanceTo(int64_t new_time_ns)
+{
+  uint64_t tick;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (new_time_ns > time_ns.load(std::memory_order_relaxed))
+      time_ns.store(new_time_ns, std::memory_order_release);
+    tick = ++current_tick;
+    pending_completions = lockstep_participants;
+  }
+  condition.notify_all();
+
+  {
+    std::lock_guard<std::mutex> lock(listener_mutex);
+    for (const std::pair<ListenerId, std::function<void()>>& listener : listeners)
+      listener.second();
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  tick_condition.wait(lock, [this, tick]() { return pending_completions == 0 || current_tick != tick; });
+}
+
+uint64_t ManualClock::getTick() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return current_tick;
+}
+
+int64_t ManualClock::now() const
+{
+  return time_ns.load(std::memory_order_acquire);
+}
+
+bool ManualClock::isSimulated() const
+{
+  return true;
+}
+
+bool ManualClock::sleepUntil(int64_t deadline_ns)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  return condition.wait_for(lock, MAX_SIMULATED_WAIT, [this, deadline_ns]() { return now() >= deadline_ns; });
+}
+
+void ManualClock::waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& waiter_condition,
+                            int64_t deadline_ns)
+{
+  if (now() < deadline_ns)
+    waiter_condition.wait_for(lock, MAX_SIMULATED_WAIT);
+}
+
+ProcessClock::ListenerId ManualClock::addAdvanceListener(const std::function<void()>& listener)
+{
+  std::lock_guard<std::mutex> lock(listener_mutex);
+  const ListenerId id = next_listener++;
+  listeners.push_back(std::make_pair(id, listener));
+  return id;
+}
+
+void ManualClock::removeAdvanceListener(ListenerId listener)
+{
+  std::lock_guard<std::mutex> lock(listener_mutex);
+  for (size_t i = 0; i < listeners.size(); i++)
+  {
+    if (listeners[i].first == listener)
+    {
+      listeners.erase(listeners.begin() + i);
+      return;
+    }
+  }
+}
+
+uint64_t ManualClock::joinLockstep()
+{
+  // The participant is not counted in the tick being executed, if any: it starts with the next one.
+  std::lock_guard<std::mutex> lock(mutex);
+  lockstep_participants++;
+  return current_tick;
+}
+
+bool ManualClock::waitForTick(uint64_t previous_tick, uint64_t& tick)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  if (!condition.wait_for(lock, MAX_SIMULATED_WAIT, [this, previous_tick]() { return current_tick != previous_tick; }))
+    return false;
+  tick = current_tick;
+  return true;
+}
+
+void ManualClock::completeTick(uint64_t tick)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tick != current_tick || pending_completions == 0)
+      return;
+    pending_completions--;
+  }
+  tick_condition.notify_all();
+}
+
+void ManualClock::leaveLockstep(uint64_t last_tick)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    lockstep_participants--;
+    // A participant that has not reached the current tick was counted in it, and it will not complete it.
+    if (last_tick != current_tick && pending_completions > 0)
+      pending_completions--;
+  }
+  tick_condition.notify_all();
+}
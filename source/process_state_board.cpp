@@ -0,0 +1,361 @@
+/*!*******************************************************************************************
+ *  \file       process_state_board.cpp
+ *  \brief      ProcessStateBoard implementation file.
+ *  \details    This file implements the ProcessStateBoard class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/process_state_board.h"
+
+#include <mutex>
+#include <set>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+const uint32_t BOARD_MAGIC = 0x52504204;  // "RPB" and the layout version.
+
+// Failed reads of a slot after which a reader checks if its owner is still alive.
+const uint32_t READ_ATTEMPTS_PER_CHECK = 1024;
+
+// A slot is owned by a PID and a token, because every process hosted by a container has the same PID. The tokens of
+// the slots claimed by this OS process are kept until they are released, so a slot of this PID whose token is not
+// among them was left by a dead process that had the same PID.
+struct OwnerTokens
+{
+  OwnerTokens() : next(1)
+  {
+  }
+
+  std::mutex mutex;
+  uint32_t next;
+  std::set<uint32_t> claimed;
+};
+
+OwnerTokens& ownerTokens()
+{
+  static OwnerTokens tokens;
+  return tokens;
+}
+
+uint64_t makeOwner(int32_t pid, uint32_t token)
+{
+  return static_cast<uint64_t>(static_cast<uint32_t>(pid)) << 32 | token;
+}
+
+// Returns true if the process that owns a slot still exists.
+bool isOwnerAlive(uint64_t owner)
+{
+  const int32_t pid = static_cast<int32_t>(owner >> 32);
+  if (pid != getpid())
+    return ProcessStateBoard::isAlive(pid);
+
+  OwnerTokens& tokens = ownerTokens();
+  std::lock_guard<std::mutex> lock(tokens.mutex);
+  return tokens.claimed.count(static_cast<uint32_t>(owner)) != 0;
+}
+}  // namespace
+
+struct ProcessStateBoard::Slot
+{
+  std::atomic<uint64_t> owner;     //!< PID and token of the process owning the slot, 0 if it is free.
+  std::atomic<uint32_t> sequence;  //!< Sequence lock, odd while the entry is being written.
+  Entry entry;                     //!< Data of the process.
+};
+
+struct ProcessStateBoard::Segment
+{
+  std::atomic<uint32_t> magic;  //!< BOARD_MAGIC once the segment is in use, 0 when just created.
+  Slot slots[SLOT_COUNT];
+};
+
+ProcessStateBoard::ProcessStateBoard() : segment(nullptr), slot(nullptr), token(0)
+{
+  writer_lock.clear();
+}
+
+ProcessStateBoard::~ProcessStateBoard()
+{
+  unregisterProcess();
+}
+
+std::string ProcessStateBoard::segmentName(const std::string& hostname)
+{
+  std::string name = "/robot_process_board_" + hostname;
+  for (size_t i = 1; i < name.size(); i++)
+  {
+    if (name[i] == '/')
+      name[i] = '_';
+  }
+  return name;
+}
+
+ProcessStateBoard::Segment* ProcessStateBoard::openSegment(const std::string& hostname, bool create)
+{
+  const std::string name = segmentName(hostname);
+  const int fd = shm_open(name.c_str(), create ? O_CREAT | O_RDWR : O_RDONLY, 0666);
+  if (fd < 0)
+    return nullptr;
+
+  // The umask may have removed the permissions of the other users, who must be able to register too. Only the owner
+  // of the segment can change them, so the processes of other users just fail.
+  if (create)
+    fchmod(fd, 0666);
+
+  // A new segment is filled with zeros, which is a valid board with every slot free.
+  if (create && ftruncate(fd, sizeof(Segment)) != 0)
+  {
+    close(fd);
+    return nullptr;
+  }
+
+  void* address = mmap(nullptr, sizeof(Segment), create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (address == MAP_FAILED)
+    return nullptr;
+
+  Segment* board = static_cast<Segment*>(address);
+  if (create)
+  {
+    uint32_t magic = 0;
+    board->magic.compare_exchange_strong(magic, BOARD_MAGIC);
+  }
+
+  if (board->magic.load(std::memory_order_acquire) != BOARD_MAGIC)
+  {
+    munmap(address, sizeof(Segment));
+    return nullptr;
+  }
+  return board;
+}
+
+bool ProcessStateBoard::registerProcess(const std::string& hostname, const std::string& process_name)
+{
+  unregisterProcess();
+
+  segment = openSegment(hostname, true);
+  if (segment == nullptr)
+    return false;
+
+  const int32_t pid = getpid();
+  {
+    OwnerTokens& tokens = ownerTokens();
+    std::lock_guard<std::mutex> lock(tokens.mutex);
+    token = tokens.next++;
+    tokens.claimed.insert(token);
+  }
+
+  const uint64_t claim = makeOwner(pid, token);
+  for (uint32_t i = 0; i < SLOT_COUNT && slot == nullptr; i++)
+  {
+    Slot& candidate = segment->slots[i];
+    uint64_t owner = candidate.owner.load(std::memory_order_acquire);
+    if (owner != 0 && isOwnerAlive(owner))
+      continue;
+    if (candidate.owner.compare_exchange_strong(owner, claim, std::memory_order_acq_rel))
+      slot = &candidate;
+  }
+
+  if (slot == nullptr)
+  {
+    releaseToken();
+    munmap(segment, sizeof(Segment));
+    segment = nullptr;
+    return false;
+  }
+
+  // An owner that died in the middle of a write left the sequence odd, which would make the first write of this
+  // process leave it odd too.
+  const uint32_t sequence = slot->sequence.load(std::memory_order_relaxed);
+  slot->sequence.store((sequence + 1) & ~static_cast<uint32_t>(1), std::memory_order_release);
+
+  beginWrite();
+  memset(&slot->entry, 0, sizeof slot->entry);
+  strncpy(slot->entry.name, process_name.c_str(), NAME_LENGTH - 1);
+  slot->entry.pid = pid;
+  slot->entry.state = ProcessState::CREATED;
+  endWrite();
+  return true;
+}
+
+void ProcessStateBoard::unregisterProcess()
+{
+  if (slot != nullptr)
+  {
+    beginWrite();
+    slot->entry.pid = 0;
+    endWrite();
+    slot->owner.store(0, std::memory_order_release);
+    slot = nullptr;
+    releaseToken();
+  }
+
+  if (segment != nullptr)
+  {
+    munmap(segment, sizeof(Segment));
+    segment = nullptr;
+  }
+}
+
+bool ProcessStateBoard::attach(const std::string& hostname)
+{
+  unregisterProcess();
+  segment = openSegment(hostname, false);
+  return segment != nullptr;
+}
+
+void ProcessStateBoard::beginWrite()
+{
+  while (writer_lock.test_and_set(std::memory_order_acquire))
+  {
+  }
+  const uint32_t sequence = slot->sequence.load(std::memory_order_relaxed);
+  slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void ProcessStateBoard::endWrite()
+{
+  const uint32_t sequence = slot->sequence.load(std::memory_order_relaxed);
+  slot->sequence.store(sequence + 1, std::memory_order_release);
+  writer_lock.clear(std::memory_order_release);
+}
+
+void ProcessStateBoard::updateState(ProcessState state)
+{
+  if (slot == nullptr)
+    return;
+
+  beginWrite();
+  slot->entry.state = state;
+  slot->entry.state_changes++;
+  endWrite();
+}
+
+void ProcessStateBoard::updateRun(int64_t last_run_ns, uint64_t missed_deadlines)
+{
+  if (slot == nullptr)
+    return;
+
+  beginWrite();
+  slot->entry.last_run_ns = last_run_ns;
+  slot->entry.run_count++;
+  slot->entry.missed_deadlines = missed_deadlines;
+  endWrite();
+}
+
+void ProcessStateBoard::updateLockstep(const std::string& group, bool lockstep, int64_t completed_tick_ns)
+{
+  if (slot == nullptr)
+    return;
+
+  beginWrite();
+  strncpy(slot->entry.lockstep_group, group.c_str(), GROUP_LENGTH - 1);
+  slot->entry.lockstep = lockstep;
+  slot->entry.completed_tick_ns = completed_tick_ns;
+  endWrite();
+}
+
+bool ProcessStateBoard::readEntries(std::vector<Entry>& entries) const
+{
+  entries.clear();
+  if (segment == nullptr)
+    return false;
+
+  readSegment(segment, entries);
+  return true;
+}
+
+bool ProcessStateBoard::read(const std::string& hostname, std::vector<Entry>& entries)
+{
+  entries.clear();
+
+  Segment* board = openSegment(hostname, false);
+  if (board == nullptr)
+    return false;
+
+  readSegment(board, entries);
+  munmap(board, sizeof(Segment));
+  return true;
+}
+
+bool ProcessStateBoard::isAlive(int32_t pid)
+{
+  return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+void ProcessStateBoard::releaseToken()
+{
+  OwnerTokens& tokens = ownerTokens();
+  std::lock_guard<std::mutex> lock(tokens.mutex);
+  tokens.claimed.erase(token);
+  token = 0;
+}
+
+void ProcessStateBoard::readSegment(const Segment* board, std::vector<Entry>& entries)
+{
+  for (uint32_t i = 0; i < SLOT_COUNT; i++)
+  {
+    const Slot& candidate = board->slots[i];
+    if (candidate.owner.load(std::memory_order_acquire) == 0)
+      continue;
+
+    Entry entry;
+    bool consistent = false;
+    for (uint32_t attempt = 1; !consistent; attempt++)
+    {
+      const uint32_t before = candidate.sequence.load(std::memory_order_acquire);
+      memcpy(&entry, &candidate.entry, sizeof entry);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      const uint32_t after = candidate.sequence.load(std::memory_order_relaxed);
+      consistent = (before & 1) == 0 && before == after;
+
+      // A writer that died in the middle of a write leaves the sequence odd until its slot is claimed again.
+      if (!consistent && attempt % READ_ATTEMPTS_PER_CHECK == 0)
+      {
+        const uint64_t owner = candidate.owner.load(std::memory_order_acquire);
+        if (owner == 0 || !isOwnerAlive(owner))
+          break;
+      }
+    }
+
+    if (consistent && entry.pid != 0)
+      entries.push_back(entry);
+  }
+}
@@ -0,0 +1,181 @@
+/*!*******************************************************************************************
+ *  \file       realtime_thread.cpp
+ *  \brief      RealtimeThread implementation file.
+ *  \details    This file implements the RealtimeThread class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/realtime_thread.h"
+#include "../include/tracer.h"
+
+#include <algorithm>
+#include <alloca.h>
+#include <malloc.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+#include <ros/ros.h>
+
+namespace
+{
+//! Writes every page of a stack region so the kernel maps it before the real-time loop starts.
+__attribute__((noinline)) void prefaultStack(size_t bytes)
+{
+  volatile char* stack = static_cast<volatile char*>(alloca(bytes));
+  const long page_size = sysconf(_SC_PAGESIZE);
+  for (size_t i = 0; i < bytes; i += page_size)
+    stack[i] = 0;
+}
+}  // namespace
+
+RealtimeThread::RealtimeThread() : thread(), started(false)
+{
+}
+
+RealtimeThread::~RealtimeThread()
+{
+  join();
+}
+
+bool RealtimeThread::start(const RealtimeConfig& thread_config, const std::function<void()>& thread_body)
+{
+  join();
+  config = thread_config;
+  body = thread_body;
+
+  // CPU_SET() writes out of the set with indexes beyond CPU_SETSIZE.
+  const long cpu_count = std::min<long>(sysconf(_SC_NPROCESSORS_CONF), CPU_SETSIZE);
+  for (size_t i = 0; i < config.cpus.size();)
+  {
+    if (config.cpus[i] < 0 || config.cpus[i] >= cpu_count)
+    {
+      ROS_WARN("The real-time thread ignores the CPU %d, the computer has %ld CPUs", config.cpus[i], cpu_count);
+      config.cpus.erase(config.cpus.begin() + i);
+    }
+    else
+      i++;
+  }
+
+  if (!config.enabled)
+    return create(false);
+  if (create(true))
+    return true;
+
+  ROS_WARN("The real-time thread could not be created with SCHED_FIFO priority %d, using the default policy",
+           config.priority);
+  return create(false);
+}
+
+bool RealtimeThread::create(bool realtime)
+{
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+
+  size_t stack_size = 0;
+  pthread_attr_getstacksize(&attributes, &stack_size);
+  if (config.enabled && stack_size < config.stack_prefault_bytes + 256 * 1024)
+    pthread_attr_setstacksize(&attributes, config.stack_prefault_bytes + 256 * 1024);
+
+  if (realtime)
+  {
+    sched_param parameters;
+    memset(&parameters, 0, sizeof parameters);
+    parameters.sched_priority = config.priority;
+    pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attributes, SCHED_FIFO);
+    pthread_attr_setschedparam(&attributes, &parameters);
+  }
+
+  if (!config.cpus.empty())
+  {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu : config.cpus)
+      CPU_SET(cpu, &cpus);
+    pthread_attr_setaffinity_np(&attributes, sizeof cpus, &cpus);
+  }
+
+  started = pthread_create(&thread, &attributes, &RealtimeThread::entry, this) == 0;
+  pthread_attr_destroy(&attributes);
+  return started;
+}
+
+void RealtimeThread::join()
+{
+  if (started)
+  {
+    pthread_join(thread, nullptr);
+    started = false;
+  }
+}
+
+void* RealtimeThread::entry(void* argument)
+{
+  RealtimeThread* self = static_cast<RealtimeThread*>(argument);
+  if (self->config.enabled && self->config.timer_slack_ns > 0)
+    prctl(PR_SET_TIMERSLACK, self->config.timer_slack_ns);
+  if (self->config.enabled && self->config.stack_prefault_bytes > 0)
+    prefaultStack(self->config.stack_prefault_bytes);
+  Tracer::registerThread();
+
+  self->body();
+  return nullptr;
+}
+
+bool RealtimeThread::lockMemory(size_t heap_reserve_bytes)
+{
+  // The allocator is only changed if the memory can be locked, otherwise it would keep a heap that is never trimmed
+  // without any benefit.
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    return false;
+
+  // Memory released by free() stays in the heap, so the reserve below keeps being mapped and locked.
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+
+  if (heap_reserve_bytes > 0)
+  {
+    char* reserve = static_cast<char*>(malloc(heap_reserve_bytes));
+    if (reserve != nullptr)
+    {
+      const long page_size = sysconf(_SC_PAGESIZE);
+      for (size_t i = 0; i < heap_reserve_bytes; i += page_size)
+        reserve[i] = 0;
+      free(reserve);
+    }
+  }
+  return true;
+}
@@ -35,91 +35,928 @@
  ********************************************************************************/
 
 #include "../include/robot_process.h"
+#include "../include/ros_transport.h"
+#include "../include/ros_clock.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+
+namespace
+{
+const int64_t NANOSECONDS_PER_SECOND = 1000000000;
+
+// The allocation counters and the trace belong to the whole executable, which may host several processes, so they are
+// reported once, when the last process is destroyed. The trace goes to the file of the first process that enables the
+// tracer.
+struct ExecutableReports
+{
+  ExecutableReports() : processes(0)
+  {
+  }
+
+  std::mutex mutex;
+  int processes;           // RobotProcess objects that exist.
+  std::string trace_file;  // File of the trace, empty until a process enables the tracer.
+};
+
+ExecutableReports& executableReports()
+{
+  static ExecutableReports reports;
+  return reports;
+}
+
+// Returns the file of the trace of the executable, or 'process_trace_file' if no process has enabled the tracer.
+std::string executableTraceFile(const std::string& process_trace_file)
+{
+  ExecutableReports& reports = executableReports();
+  std::lock_guard<std::mutex> lock(reports.mutex);
+  return reports.trace_file.empty() ? process_trace_file : reports.trace_file;
+}
+
+int64_t monotonicNow()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * NANOSECONDS_PER_SECOND + now.tv_nsec;
+}
+}  // namespace
 
 RobotProcess::RobotProcess()
+  : data_spinner_threads(0)
+  , shut_down(false)
+  , lockstep(false)
+  , async_lifecycle(false)
+  , lifecycle_worker_active(false)
+  , heartbeat_rate(0)
+  , heartbeat_seq(0)
+  , metrics_rate(0)
+  , state_changes(0)
+  , signal_thread_active(false)
+  , declared_triggers(0)
+  , pending_triggers(0)
+  , fired_triggers(0)
+  , trigger_policy(TriggerPolicy::ANY_OF)
+  , trigger_loop_active(false)
+  , current_state(State::CREATED)
+  , scheduled_run_duration_ns(0)
+  , cycle_release_ns(0)
+  , setup_time_ns(0)
 {
   char buf[32];
   gethostname(buf, sizeof buf);
   hostname.append(buf);
 
-  current_state = STATE_CREATED;
+  memset(&run_statistics, 0, sizeof run_statistics);
+
+  ExecutableReports& reports = executableReports();
+  std::lock_guard<std::mutex> lock(reports.mutex);
+  reports.processes++;
 }
 
-RobotProcess::~RobotProcess(){
+RobotProcess::~RobotProcess()
+{
+  if (signal_thread.joinable() && !shut_down)
+  {
+    ROS_ERROR("Node %s was not shut down by the destructor of its class, a request received now may call its "
+              "destroyed 'own' functions",
+              processName().c_str());
+    shutdown();
+  }
+
+  std::string executable_trace_file;
+  {
+    ExecutableReports& reports = executableReports();
+    std::lock_guard<std::mutex> lock(reports.mutex);
+    if (--reports.processes > 0)
+      return;
+    executable_trace_file.swap(reports.trace_file);
+  }
+
+  // In a container the name of the node is the name of the container, not the one of this process.
+  const std::string node_name = ros::this_node::getName().empty() ? processName() : ros::this_node::getName();
+  if (AllocationProfiler::isAvailable())
+  {
+    for (int phase = 0; phase < AllocationProfiler::PHASE_COUNT; phase++)
+    {
+      const AllocationProfiler::PhaseStatistics statistics =
+          AllocationProfiler::getStatistics(static_cast<AllocationPhase>(phase));
+      ROS_INFO("Node %s allocations in %s: %llu (%llu bytes), deallocations: %llu", node_name.c_str(),
+               AllocationProfiler::phaseName(static_cast<AllocationPhase>(phase)),
+               static_cast<unsigned long long>(statistics.allocations),
+               static_cast<unsigned long long>(statistics.bytes),
+               static_cast<unsigned long long>(statistics.deallocations));
+    }
+  }
+
+  if (Tracer::isEnabled() && !executable_trace_file.empty() && !Tracer::writeChromeTrace(executable_trace_file))
+    ROS_ERROR("Node %s could not write its trace to %s", node_name.c_str(), executable_trace_file.c_str());
+}
+
+void RobotProcess::shutdown()
+{
+  // No request is served after this, so no lifecycle step can be queued.
+  if (transport)
+    transport->shutdown();
+
+  // The step being executed is finished, and the pending ones are discarded.
+  {
+    std::lock_guard<std::mutex> lock(lifecycle_worker_mutex);
+    lifecycle_worker_active = false;
+    lifecycle_worker_jobs.clear();
+  }
+  lifecycle_worker_condition.notify_all();
+  if (lifecycle_worker.joinable())
+    lifecycle_worker.join();
+
+  task_scheduler.stop();
+  worker_pool.stop();
+  stopTriggerLoop();
+
+  {
+    std::lock_guard<std::mutex> lock(signal_mutex);
+    signal_thread_active = false;
+  }
+  signal_condition.notify_all();
+  if (signal_thread.joinable())
+    signal_thread.join();
+
+  shut_down = true;
 }
 
 void RobotProcess::setUp()
 {
-  stop_server_srv = node_handler_robot_process.advertiseService(ros::this_node::getName() + "/stop",
-                                                                &RobotProcess::stopSrvCall, this);
-  start_server_srv = node_handler_robot_process.advertiseService(ros::this_node::getName() + "/start",
-                                                                 &RobotProcess::startSrvCall, this);
+  if (!transport)
+    transport = std::make_shared<RosTransport>();
+
+  bool trace;
+  int trace_events_per_thread;
+  int trace_buffers;
+  transport->param("trace", trace, false);
+  transport->param("trace_file", trace_file, defaultTraceFile());
+  transport->param("trace_events_per_thread", trace_events_per_thread,
+                   static_cast<int>(Tracer::DEFAULT_EVENTS_PER_THREAD));
+  transport->param("trace_buffers", trace_buffers, static_cast<int>(Tracer::DEFAULT_PREALLOCATED_BUFFERS));
+  if (trace)
+  {
+    {
+      ExecutableReports& reports = executableReports();
+      std::lock_guard<std::mutex> lock(reports.mutex);
+      if (reports.trace_file.empty())
+      {
+        reports.trace_file = trace_file;
+        Tracer::configure(static_cast<uint32_t>(std::max(trace_events_per_thread, 1)),
+                          static_cast<uint32_t>(std::max(trace_buffers, 0)));
+      }
+    }
+    Tracer::setEnabled(true);
+  }
+  ROBOT_PROCESS_TRACE_SCOPE("RobotProcess::setUp");
+  ROBOT_PROCESS_ALLOCATION_PHASE(SET_UP);
+
+  if (!clock)
+  {
+    std::string clock_type;
+    transport->param("clock", clock_type, "real");
+    if (clock_type == "ros")
+      clock = std::make_shared<RosClock>();
+    else
+    {
+      if (clock_type != "real")
+        ROS_WARN("In node %s, unknown value %s of parameter clock", processName().c_str(), clock_type.c_str());
+      clock = std::make_shared<RealClock>();
+    }
+  }
+  transport->param("lockstep", lockstep, false);
+  if (lockstep && !clock->isSimulated())
+  {
+    ROS_WARN("Node %s cannot run in lockstep with a real clock", processName().c_str());
+    lockstep = false;
+  }
+  // Only a clock shared by other processes of the host is coordinated through the board.
+  transport->param("lockstep_group", lockstep_group, std::dynamic_pointer_cast<RosClock>(clock) ? "/clock" : "");
+  task_scheduler.setClock(clock);
+
+  setup_time_ns = clock->now();
+
+  ProcessRequestHandlers handlers;
+  handlers.start = [this]() { return start(); };
+  handlers.stop = [this]() { return stop(); };
+  handlers.pause = [this]() { return pause(); };
+  handlers.resume = [this]() { return resume(); };
+  handlers.dump_trace = [this]() { return dumpTrace(); };
+  handlers.get_status = [this]() { return getStatus(); };
+  handlers.get_state = [this]() { return getState(); };
+  transport->advertise(handlers);
+
+  const std::shared_ptr<RosTransport> ros_transport = std::dynamic_pointer_cast<RosTransport>(transport);
+  if (ros_transport)
+  {
+    start_server_srv = ros_transport->startService();
+    stop_server_srv = ros_transport->stopService();
+    is_running_srv = ros_transport->isRunningService();
+  }
+
+  transport->param("drone_id", drone_id, "1");
+  transport->param("heartbeat_rate", heartbeat_rate, 1.0);
+  transport->param("metrics_rate", metrics_rate, 1.0);
+  transport->param("data_spinner_threads", data_spinner_threads, 0);
+  transport->param("async_lifecycle", async_lifecycle, false);
+
+  int arena_bytes;
+  transport->param("arena_bytes", arena_bytes, 1024 * 1024);
+  cycle_arena.reserve(static_cast<size_t>(std::max(arena_bytes, 0)));
+
+  transport->param("realtime/enabled", realtime_config.enabled, false);
+  transport->param("realtime/priority", realtime_config.priority, realtime_config.priority);
+  transport->param("realtime/cpus", realtime_config.cpus, std::vector<int>());
+  transport->param("realtime/lock_memory", realtime_config.lock_memory, realtime_config.lock_memory);
+  int stack_prefault_bytes, heap_reserve_bytes, timer_slack_ns;
+  transport->param("realtime/stack_prefault_bytes", stack_prefault_bytes,
+                   static_cast<int>(realtime_config.stack_prefault_bytes));
+  transport->param("realtime/heap_reserve_bytes", heap_reserve_bytes,
+                   static_cast<int>(realtime_config.heap_reserve_bytes));
+  transport->param("realtime/timer_slack_ns", timer_slack_ns, static_cast<int>(realtime_config.timer_slack_ns));
+  realtime_config.stack_prefault_bytes = std::max(stack_prefault_bytes, 0);
+  realtime_config.heap_reserve_bytes = std::max(heap_reserve_bytes, 0);
+  realtime_config.timer_slack_ns = timer_slack_ns;
+  if (realtime_config.enabled && realtime_config.lock_memory &&
+      !RealtimeThread::lockMemory(realtime_config.heap_reserve_bytes))
+    ROS_WARN("Node %s could not lock its memory: %s", processName().c_str(), strerror(errno));
+
+  std::string allocation_strict;
+  int allocation_warmup_cycles;
+  transport->param("allocation_strict", allocation_strict, "off");
+  transport->param("allocation_warmup_cycles", allocation_warmup_cycles, 100);
+  if (allocation_strict == "log" || allocation_strict == "abort")
+  {
+    if (!AllocationProfiler::isAvailable())
+      ROS_WARN("Node %s cannot check its allocations, robot_process was built without ROBOT_PROCESS_ALLOC_PROFILER",
+               processName().c_str());
+    AllocationProfiler::setStrictMode(allocation_strict == "log" ? AllocationProfiler::StrictMode::LOG :
+                                                                   AllocationProfiler::StrictMode::ABORT,
+                                      static_cast<uint64_t>(std::max(allocation_warmup_cycles, 0)));
+  }
+  else if (allocation_strict != "off")
+    ROS_WARN("In node %s, unknown value %s of parameter allocation_strict", processName().c_str(),
+             allocation_strict.c_str());
+
+  bool use_state_board;
+  transport->param("state_board", use_state_board, true);
+  if (use_state_board && !state_board.registerProcess(hostname, processName()))
+    ROS_WARN("Node %s could not register in the process state board of %s", processName().c_str(),
+             hostname.c_str());
+
+  if (async_lifecycle)
+  {
+    lifecycle_worker_active = true;
+    lifecycle_worker = std::thread(&RobotProcess::lifecycleWorker, this);
+  }
+
+  signal_thread_active = true;
+  signal_thread = std::thread(&RobotProcess::signalThread, this);
+
+  int worker_threads;
+  transport->param("worker_threads", worker_threads, 0);
+  worker_pool.start(std::max(worker_threads, 0));
+
+  {
+    ROBOT_PROCESS_TRACE_SCOPE("ownSetUp");
+    ownSetUp();
+  }
+  setState(State::READY_TO_START);
+
+  if (task_scheduler.hasTasks())
+  {
+    int scheduler_threads;
+    transport->param("scheduler_threads", scheduler_threads, 1);
+    task_scheduler.start(std::max(scheduler_threads, 1));
+  }
+
+  transport->startServing(data_spinner_threads);
+}
+
+void RobotProcess::lifecycleWorker()
+{
+  std::unique_lock<std::mutex> lock(lifecycle_worker_mutex);
+  while (true)
+  {
+    lifecycle_worker_condition.wait(lock,
+                                    [this]() { return !lifecycle_worker_active || !lifecycle_worker_jobs.empty(); });
+    if (!lifecycle_worker_active)
+      return;
 
-  ownSetUp();
-  setState(STATE_READY_TO_START);
+    std::function<void()> step = lifecycle_worker_jobs.front();
+    lifecycle_worker_jobs.pop_front();
+    lock.unlock();
+    step();
+    lock.lock();
+  }
 }
 
-void RobotProcess::start()
+void RobotProcess::runLifecycleStep(const std::function<void()>& step)
 {
-  setState(STATE_RUNNING);
-  ownStart();
+  if (!async_lifecycle)
+  {
+    step();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(lifecycle_worker_mutex);
+    lifecycle_worker_jobs.push_back(step);
+  }
+  lifecycle_worker_condition.notify_one();
 }
 
-void RobotProcess::stop()
+bool RobotProcess::start()
 {
-  setState(STATE_READY_TO_START);
-  ownStop();
+  ROBOT_PROCESS_TRACE_SCOPE("RobotProcess::start");
+
+  if (!tryTransition<State::READY_TO_START, State::STARTING>())
+    return false;
+
+  runLifecycleStep([this]() {
+    {
+      ROBOT_PROCESS_TRACE_SCOPE("ownStart");
+      ROBOT_PROCESS_ALLOCATION_PHASE(START);
+      ownStart();
+    }
+    tryTransition<State::STARTING, State::RUNNING>();
+  });
+  return true;
 }
 
-RobotProcess::State RobotProcess::getState()
+bool RobotProcess::stop()
 {
-  return current_state;
+  ROBOT_PROCESS_TRACE_SCOPE("RobotProcess::stop");
+
+  if (!tryTransition<State::RUNNING, State::STOPPING>() && !tryTransition<State::PAUSED, State::STOPPING>())
+    return false;
+
+  runLifecycleStep([this]() {
+    // The tasks were disabled by the transition, but ownStop() must not run concurrently with one still executing.
+    task_scheduler.waitForIdle();
+    {
+      ROBOT_PROCESS_TRACE_SCOPE("ownStop");
+      ownStop();
+    }
+    tryTransition<State::STOPPING, State::READY_TO_START>();
+  });
+  return true;
 }
 
-void RobotProcess::setState(State new_state)
+bool RobotProcess::pause()
 {
-  if (new_state == STATE_CREATED || new_state == STATE_READY_TO_START || new_state == STATE_RUNNING ||
-      new_state == STATE_PAUSED || new_state == STATE_STARTED || new_state == STATE_NOT_STARTED)
+  ROBOT_PROCESS_TRACE_SCOPE("RobotProcess::pause");
+
+  if (!tryTransition<State::RUNNING, State::PAUSED>())
+    return false;
+
   {
-    current_state = new_state;
+    ROBOT_PROCESS_TRACE_SCOPE("ownPause");
+    ownPause();
   }
-  else
+  return true;
+}
+
+bool RobotProcess::resume()
+{
+  ROBOT_PROCESS_TRACE_SCOPE("RobotProcess::resume");
+
+  if (!tryTransition<State::PAUSED, State::RUNNING>())
+    return false;
+
   {
-    ROS_ERROR("In node %s, current state cannot be changed to new state %d", ros::this_node::getName().c_str(),
-              new_state);
+    ROBOT_PROCESS_TRACE_SCOPE("ownResume");
+    ownResume();
   }
+  return true;
 }
 
-bool RobotProcess::stopSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response)
+RobotProcess::State RobotProcess::getState() const
 {
-  if (current_state == STATE_RUNNING)
+  return current_state.load(std::memory_order_acquire);
+}
+
+bool RobotProcess::tryTransition(State from, State to)
+{
+  if (!isLegalTransition(from, to))
+    return false;
+
+  std::lock_guard<std::recursive_mutex> lock(transition_mutex);
+  State expected = from;
+  if (!current_state.compare_exchange_strong(expected, to, std::memory_order_acq_rel, std::memory_order_acquire))
+    return false;
+
+  notifyStateChange(from, to);
+  return true;
+}
+
+bool RobotProcess::setState(State new_state)
+{
+  std::lock_guard<std::recursive_mutex> lock(transition_mutex);
+  State old_state = getState();
+  do
+  {
+    if (!isLegalTransition(old_state, new_state))
+    {
+      ROS_ERROR("In node %s, current state %s cannot be changed to new state %s", processName().c_str(),
+                processStateName(old_state), processStateName(new_state));
+      return false;
+    }
+  } while (!current_state.compare_exchange_weak(old_state, new_state, std::memory_order_acq_rel,
+                                                std::memory_order_acquire));
+
+  notifyStateChange(old_state, new_state);
+  return true;
+}
+
+bool RobotProcess::setState(uint8_t new_state)
+{
+  if (new_state == 0 || new_state >= PROCESS_STATE_TABLE_SIZE)
+  {
+    ROS_ERROR("In node %s, current state cannot be changed to new state %d", processName().c_str(), new_state);
+    return false;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(transition_mutex);
+  const State state = static_cast<State>(new_state);
+  const State old_state = current_state.exchange(state, std::memory_order_acq_rel);
+  if (old_state != state && !isLegalTransition(old_state, state))
+    ROS_WARN("In node %s, current state %s was changed to new state %s, which is not a legal transition",
+             processName().c_str(), processStateName(old_state), processStateName(state));
+
+  notifyStateChange(old_state, state);
+  return true;
+}
+
+void RobotProcess::notifyStateChange(State previous_state, State new_state)
+{
+  state_board.updateState(new_state);
+  task_scheduler.setEnabled(new_state == State::RUNNING);
+  worker_pool.setParked(new_state != State::RUNNING);
+
   {
-    stop();
+    std::lock_guard<std::mutex> lock(signal_mutex);
+    state_changes++;
+  }
+  signal_condition.notify_one();
+
+  if (!transport)
+    return;
+
+  ProcessStateChange change;
+  change.previous_state = previous_state;
+  change.state = new_state;
+  transport->publishStateChange(change);
+}
+
+ProcessStatus RobotProcess::getStatus() const
+{
+  const RunStatistics statistics = getRunStatistics();
+
+  ProcessStatus status;
+  status.state = getState();
+  status.uptime = clock ? static_cast<double>(clock->now() - setup_time_ns) / NANOSECONDS_PER_SECOND : 0;
+  status.cycles = statistics.cycles;
+  status.missed_deadlines = statistics.missed_deadlines;
+  status.last_run_duration_ns = statistics.last_run_duration_ns;
+  status.max_run_duration_ns = statistics.max_run_duration_ns;
+  status.mean_run_duration_ns = statistics.mean_run_duration_ns;
+  status.max_jitter_ns = statistics.max_jitter_ns;
+  return status;
+}
+
+bool RobotProcess::dumpTrace()
+{
+  const std::string file = executableTraceFile(trace_file);
+  if (Tracer::writeChromeTrace(file))
+  {
+    ROS_INFO("Node %s wrote the trace to %s", processName().c_str(), file.c_str());
     return true;
   }
   else
   {
-    ROS_WARN("Node %s received a stop call when it was already stopped", ros::this_node::getName().c_str());
+    ROS_ERROR("Node %s could not write the trace to %s", processName().c_str(), file.c_str());
     return false;
   }
 }
 
+void RobotProcess::setTransport(const std::shared_ptr<ProcessTransport>& process_transport)
+{
+  transport = process_transport;
+}
+
+void RobotProcess::setClock(const std::shared_ptr<ProcessClock>& process_clock)
+{
+  clock = process_clock;
+}
+
+std::string RobotProcess::processName() const
+{
+  return transport ? transport->processName() : ros::this_node::getName();
+}
+
+bool RobotProcess::stopSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response)
+{
+  return stop();
+}
+
 bool RobotProcess::startSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response)
 {
-  if (current_state == STATE_READY_TO_START)
+  return start();
+}
+
+ros::NodeHandle RobotProcess::getNodeHandle()
+{
+  const std::shared_ptr<RosTransport> ros_transport = std::dynamic_pointer_cast<RosTransport>(transport);
+  return ros_transport ? ros_transport->nodeHandle() : ros::NodeHandle();
+}
+
+ros::NodeHandle RobotProcess::getPrivateNodeHandle()
+{
+  const std::shared_ptr<RosTransport> ros_transport = std::dynamic_pointer_cast<RosTransport>(transport);
+  return ros_transport ? ros_transport->privateNodeHandle() : ros::NodeHandle("~");
+}
+
+std::string RobotProcess::defaultTraceFile() const
+{
+  std::string name = processName();
+  for (size_t i = 0; i < name.size(); i++)
   {
-    start();
-    return true;
+    if (name[i] == '/')
+      name[i] = '_';
   }
-  else
+  return "/tmp/robot_process" + name + "_trace.json";
+}
+
+void RobotProcess::run()
+{
+  if (isRunning())
   {
-    ROS_WARN("Node %s received a start call when it was already running", ros::this_node::getName().c_str());
+    const int64_t run_start_ns = beginRunCycle();
+    {
+      ROBOT_PROCESS_TRACE_SCOPE("ownRun");
+      ROBOT_PROCESS_ALLOCATION_PHASE(RUN);
+      ownRun();
+    }
+    endRunCycle(run_start_ns);
+  }
+}
+
+int64_t RobotProcess::beginRunCycle()
+{
+  return monotonicNow();
+}
+
+void RobotProcess::endRunCycle(int64_t run_start_ns)
+{
+  const int64_t run_end_ns = monotonicNow();
+  cycle_arena.reset();
+  AllocationProfiler::countRunCycle();
+
+  run_histogram.record(run_end_ns - run_start_ns);
+  if (state_board.isRegistered())
+    state_board.updateRun(run_end_ns, run_statistics.missed_deadlines);
+}
+
+void RobotProcess::runAtRate(double frequency)
+{
+  runCyclesAtRate(frequency, [this]() { run(); });
+}
+
+bool RobotProcess::runInLoopThread(const std::function<void()>& loop, const std::function<void()>& stop_loop)
+{
+  RealtimeThread loop_thread;
+  if (!loop_thread.start(realtime_config, loop))
     return false;
+
+  // The callbacks are served here, so the loop thread only executes run().
+  ROBOT_PROCESS_ALLOCATION_PHASE(CALLBACK);
+  transport->spin();
+  if (stop_loop)
+    stop_loop();
+  loop_thread.join();
+  return true;
+}
+
+PeriodicTaskScheduler::TaskId RobotProcess::addPeriodicTask(const std::string& name, double rate,
+                                                           const std::function<void()>& function, int priority)
+{
+  const PeriodicTaskScheduler::TaskId task = task_scheduler.addTask(name, rate, function, priority);
+  if (task == PeriodicTaskScheduler::INVALID_TASK)
+    ROS_ERROR("In node %s, task %s cannot be added with rate %f", processName().c_str(), name.c_str(),
+              rate);
+  return task;
+}
+
+std::vector<PeriodicTaskScheduler::TaskStatistics> RobotProcess::getTaskStatistics() const
+{
+  return task_scheduler.getStatistics();
+}
+
+RobotProcess::TriggerId RobotProcess::addTrigger(const std::string& name)
+{
+  if (trigger_names.size() >= MAX_TRIGGERS)
+  {
+    ROS_ERROR("In node %s, trigger %s cannot be added, the maximum is %u", processName().c_str(),
+              name.c_str(), MAX_TRIGGERS);
+    return MAX_TRIGGERS;
+  }
+
+  trigger_names.push_back(name);
+  declared_triggers |= static_cast<uint64_t>(1) << (trigger_names.size() - 1);
+  return static_cast<TriggerId>(trigger_names.size() - 1);
+}
+
+void RobotProcess::notifyTrigger(TriggerId trigger)
+{
+  if (trigger >= MAX_TRIGGERS)
+    return;
+
+  const uint64_t bit = static_cast<uint64_t>(1) << trigger;
+  const uint64_t previous = pending_triggers.fetch_or(bit, std::memory_order_acq_rel);
+  if ((previous & bit) == 0 && triggersReady(previous | bit))
+  {
+    // Taking the mutex guarantees that the trigger loop is either waiting or has not checked the triggers yet.
+    std::lock_guard<std::mutex> lock(trigger_mutex);
+    trigger_condition.notify_one();
   }
 }
 
-void RobotProcess::run()
+bool RobotProcess::triggersReady(uint64_t triggers) const
 {
-  if (current_state == STATE_RUNNING)
-    ownRun();
+  if (trigger_policy.load(std::memory_order_acquire) == TriggerPolicy::ALL_OF)
+    return declared_triggers != 0 && (triggers & declared_triggers) == declared_triggers;
+  return triggers != 0;
+}
+
+void RobotProcess::runOnTriggers(TriggerPolicy policy, double max_frequency)
+{
+  if (declared_triggers == 0)
+  {
+    ROS_ERROR("Node %s called runOnTriggers without triggers", processName().c_str());
+    return;
+  }
+  if (!transport)
+  {
+    ROS_ERROR("Node %s called runOnTriggers before setUp", processName().c_str());
+    return;
+  }
+
+  trigger_policy.store(policy, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lock(trigger_mutex);
+    trigger_loop_active = true;
+  }
+  const int64_t min_period_ns = max_frequency > 0 ? static_cast<int64_t>(NANOSECONDS_PER_SECOND / max_frequency) : 0;
+  if (!runInLoopThread([this, min_period_ns]() { triggerLoop(min_period_ns); }, [this]() { stopTriggerLoop(); }))
+    ROS_ERROR("Node %s could not create its trigger thread", processName().c_str());
+}
+
+void RobotProcess::triggerLoop(int64_t min_period_ns)
+{
+  int64_t last_run_ns = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(trigger_mutex);
+      trigger_condition.wait(lock, [this]() {
+        return !trigger_loop_active || triggersReady(pending_triggers.load(std::memory_order_acquire));
+      });
+      if (!trigger_loop_active)
+        return;
+    }
+
+    if (min_period_ns > 0 && last_run_ns != 0)
+    {
+      while (!clock->sleepUntil(last_run_ns + min_period_ns) && transport->ok())
+      {
+      }
+    }
+
+    fired_triggers = pending_triggers.exchange(0, std::memory_order_acq_rel);
+    last_run_ns = clock->now();
+    run();
+  }
+}
+
+void RobotProcess::stopTriggerLoop()
+{
+  {
+    std::lock_guard<std::mutex> lock(trigger_mutex);
+    trigger_loop_active = false;
+  }
+  trigger_condition.notify_all();
+}
+
+RobotProcess::RateLoop RobotProcess::beginRateLoop(double frequency)
+{
+  RateLoop loop;
+  loop.period_ns = static_cast<int64_t>(NANOSECONDS_PER_SECOND / frequency);
+  loop.total_run_duration_ns = 0;
+  resetRunStatistics(loop.period_ns);
+
+  loop.lockstep = lockstep;
+  loop.tick = 0;
+  if (lockstep)
+  {
+    loop.tick = clock->joinLockstep();
+    if (!lockstep_group.empty())
+      state_board.updateLockstep(lockstep_group, true, clock->now());
+  }
+  loop.deadline_ns = clock->now() + loop.period_ns;
+  return loop;
+}
+
+void RobotProcess::endRateLoop(const RateLoop& loop)
+{
+  if (loop.lockstep)
+  {
+    if (!lockstep_group.empty())
+      state_board.updateLockstep(lockstep_group, false, clock->now());
+    clock->leaveLockstep(loop.tick);
+  }
+}
+
+int64_t RobotProcess::beginRateCycle(bool spin_callbacks)
+{
+  if (spin_callbacks)
+  {
+    ROBOT_PROCESS_ALLOCATION_PHASE(CALLBACK);
+    transport->spinOnce();
+  }
+  return monotonicNow();
+}
+
+void RobotProcess::resetRunStatistics(int64_t period_ns)
+{
+  memset(&run_statistics, 0, sizeof run_statistics);
+  run_statistics.period_ns = period_ns;
+  shared_run_statistics.store(run_statistics);
+}
+
+void RobotProcess::recordRunDuration(int64_t& total_duration_ns, int64_t run_start_ns)
+{
+  const int64_t run_duration_ns = monotonicNow() - run_start_ns;
+  run_statistics.cycles++;
+  total_duration_ns += run_duration_ns;
+  run_statistics.last_run_duration_ns = run_duration_ns;
+  run_statistics.mean_run_duration_ns = total_duration_ns / static_cast<int64_t>(run_statistics.cycles);
+  if (run_duration_ns > run_statistics.max_run_duration_ns)
+    run_statistics.max_run_duration_ns = run_duration_ns;
+}
+
+void RobotProcess::recordJitter(int64_t jitter_ns)
+{
+  run_statistics.last_jitter_ns = jitter_ns;
+  if (jitter_ns > run_statistics.max_jitter_ns)
+    run_statistics.max_jitter_ns = jitter_ns;
+}
+
+void RobotProcess::endRateCycle(RateLoop& loop, int64_t run_start_ns)
+{
+  recordRunDuration(loop.total_run_duration_ns, run_start_ns);
+
+  if (loop.lockstep)
+  {
+    // The clock does not advance until the tick is completed, so there are neither deadlines nor jitter. The tick is
+    // acknowledged in the state board too, for the LockstepCoordinator of the group.
+    shared_run_statistics.store(run_statistics);
+    if (!lockstep_group.empty())
+      state_board.updateLockstep(lockstep_group, true, clock->now());
+    clock->completeTick(loop.tick);
+    return;
+  }
+
+  // Skip the periods that have already expired without losing the phase of the schedule.
+  const int64_t missed = ProcessClock::expiredPeriods(clock->now(), loop.deadline_ns, loop.period_ns);
+  run_statistics.missed_deadlines += missed;
+  loop.deadline_ns += missed * loop.period_ns;
+
+  while (!clock->sleepUntil(loop.deadline_ns) && transport->ok())
+  {
+  }
+
+  recordJitter(clock->now() - loop.deadline_ns);
+  shared_run_statistics.store(run_statistics);
+
+  loop.deadline_ns += loop.period_ns;
+}
+
+void RobotProcess::beginScheduledRuns(double frequency)
+{
+  scheduled_run_duration_ns = 0;
+  resetRunStatistics(static_cast<int64_t>(NANOSECONDS_PER_SECOND / frequency));
+}
+
+void RobotProcess::runScheduledCycle(int64_t release_ns)
+{
+  recordJitter(clock->now() - release_ns);
+  const int64_t run_start_ns = beginRateCycle(true);
+  run();
+  recordRunDuration(scheduled_run_duration_ns, run_start_ns);
+
+  // The scheduler skips the releases that expire during the cycle, as runAtRate() skips the periods.
+  run_statistics.missed_deadlines +=
+      ProcessClock::expiredPeriods(clock->now(), release_ns + run_statistics.period_ns, run_statistics.period_ns);
+  shared_run_statistics.store(run_statistics);
+}
+
+RobotProcess::RunStatistics RobotProcess::getRunStatistics() const
+{
+  return shared_run_statistics.load();
+}
+
+void RobotProcess::signalThread()
+{
+  const int64_t heartbeat_period_ns =
+      heartbeat_rate > 0 ? static_cast<int64_t>(NANOSECONDS_PER_SECOND / heartbeat_rate) : 0;
+  const int64_t metrics_period_ns = metrics_rate > 0 ? static_cast<int64_t>(NANOSECONDS_PER_SECOND / metrics_rate) : 0;
+
+  // A simulated clock wakes up the thread every time it advances, so the signals follow the simulated time.
+  const ProcessClock::ListenerId clock_listener = clock->addAdvanceListener([this]() {
+    std::lock_guard<std::mutex> lock(signal_mutex);
+    signal_condition.notify_all();
+  });
+
+  int64_t next_heartbeat_ns = clock->now();
+  int64_t next_metrics_ns = next_heartbeat_ns + metrics_period_ns;
+  bool pending_heartbeat = true;
+
+  std::unique_lock<std::mutex> lock(signal_mutex);
+  uint64_t signaled_changes = state_changes;
+  while (true)
+  {
+    const auto state_changed = [this, &signaled_changes]() {
+      return !signal_thread_active || state_changes != signaled_changes;
+    };
+    if (!pending_heartbeat && !state_changed())
+    {
+      if (heartbeat_rate > 0 && metrics_rate > 0)
+        clock->waitUntil(lock, signal_condition, std::min(next_heartbeat_ns, next_metrics_ns));
+      else if (heartbeat_rate > 0)
+        clock->waitUntil(lock, signal_condition, next_heartbeat_ns);
+      else if (metrics_rate > 0)
+        clock->waitUntil(lock, signal_condition, next_metrics_ns);
+      else
+        signal_condition.wait(lock, state_changed);
+    }
+    if (!signal_thread_active)
+      break;
+
+    pending_heartbeat = pending_heartbeat || state_changes != signaled_changes;
+    signaled_changes = state_changes;
+    lock.unlock();
+
+    const int64_t now_ns = clock->now();
+    if (pending_heartbeat || (heartbeat_rate > 0 && now_ns >= next_heartbeat_ns))
+    {
+      publishHeartbeat();
+      pending_heartbeat = false;
+      next_heartbeat_ns = now_ns + heartbeat_period_ns;
+    }
+    if (metrics_rate > 0 && now_ns >= next_metrics_ns)
+    {
+      publishMetrics();
+      next_metrics_ns += metrics_period_ns;
+      if (next_metrics_ns <= now_ns)
+        next_metrics_ns = now_ns + metrics_period_ns;
+    }
+
+    lock.lock();
+  }
+
+  lock.unlock();
+  clock->removeAdvanceListener(clock_listener);
+}
+
+void RobotProcess::publishHeartbeat()
+{
+  const State state = getState();
+
+  ProcessHeartbeatInfo heartbeat;
+  heartbeat.seq = ++heartbeat_seq;
+  heartbeat.hostname = hostname;
+  heartbeat.drone_id = drone_id;
+  heartbeat.state = state;
+  transport->publishHeartbeat(heartbeat);
+}
+
+void RobotProcess::publishMetrics()
+{
+  const LatencyHistogram::Snapshot snapshot = run_histogram.takeSnapshot();
+
+  ProcessMetrics metrics;
+  metrics.cycles = snapshot.count;
+  metrics.total_cycles = run_histogram.totalCount();
+  metrics.p50_ns = snapshot.p50;
+  metrics.p90_ns = snapshot.p90;
+  metrics.p99_ns = snapshot.p99;
+  metrics.p999_ns = snapshot.p999;
+  metrics.max_ns = snapshot.max;
+  metrics.arena_high_water_bytes = cycle_arena.takeHighWater();
+  metrics.arena_capacity_bytes = cycle_arena.getCapacity();
+  transport->publishMetrics(metrics);
 }
@@ -0,0 +1,86 @@
+/*!*******************************************************************************************
+ *  \file       robot_process_board.cpp
+ *  \brief      Command line viewer of the process state board.
+ *  \details    This file implements a tool that prints the state of every RobotProcess registered
+ *              in the shared memory board of a computer.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/process_state_board.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+/*!********************************************************************************************************************
+ * Usage: robot_process_board [hostname]
+ * Prints the processes registered in the board of the given computer, or of the local one if it is omitted.
+ *********************************************************************************************************************/
+int main(int argc, char** argv)
+{
+  std::string hostname;
+  if (argc > 1)
+  {
+    hostname = argv[1];
+  }
+  else
+  {
+    char buf[32];
+    gethostname(buf, sizeof buf);
+    hostname.append(buf);
+  }
+
+  std::vector<ProcessStateBoard::Entry> entries;
+  if (!ProcessStateBoard::read(hostname, entries))
+  {
+    fprintf(stderr, "There is no process state board for %s\n", hostname.c_str());
+    return 1;
+  }
+
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  const int64_t now_ns = static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+
+  printf("%-40s %8s %-15s %12s %12s %8s\n", "PROCESS", "PID", "STATE", "RUNS", "LAST RUN", "MISSED");
+  for (const ProcessStateBoard::Entry& entry : entries)
+  {
+    char last_run[32] = "-";
+    if (entry.run_count > 0)
+      snprintf(last_run, sizeof last_run, "%.3f s", (now_ns - entry.last_run_ns) / 1e9);
+
+    printf("%-40s %8d %-15s %12llu %12s %8llu\n", entry.name, entry.pid, processStateName(entry.state),
+           static_cast<unsigned long long>(entry.run_count), last_run,
+           static_cast<unsigned long long>(entry.missed_deadlines));
+  }
+  return 0;
+}
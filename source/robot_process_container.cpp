@@ -0,0 +1,310 @@
+/*!*******************************************************************************************
+ *  \file       robot_process_container.cpp
+ *  \brief      Container of RobotProcess plugins.
+ *  \details    This file implements the robot_process_container executable, which hosts several
+ *              RobotProcess instances in a single ROS node.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+
+#include "../include/process_chain.h"
+#include "../include/robot_process.h"
+#include "../include/ros_transport.h"
+#include "../include/run_executor.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pluginlib/class_loader.h>
+#include <ros/ros.h>
+
+namespace
+{
+//! Process hosted by the container.
+struct HostedProcess
+{
+  std::string name;                               //!< Resolved name of the process.
+  std::string type;                               //!< Plugin type of the process.
+  double rate;                                    //!< Frequency of runAtRate(), 0 if the process only has callbacks.
+  bool autostart;                                 //!< Starts the process after setting it up.
+  std::map<std::string, std::string> remappings;  //!< Remappings of the names of the process.
+  boost::shared_ptr<RobotProcess> process;        //!< Instance of the plugin.
+  bool chained;                                   //!< True if the process is executed by a chain.
+  std::thread loop;                               //!< Thread executing the loop of the process, if it has one.
+};
+
+/*!********************************************************************************************************************
+ * Reads an element of '~processes'. It must have a 'name' and a 'type', and it can have a 'rate', an 'autostart' flag
+ * and a 'remap' dictionary. Returns false if it is not valid.
+ *********************************************************************************************************************/
+bool readDescription(XmlRpc::XmlRpcValue& description, HostedProcess& hosted)
+{
+  try
+  {
+    if (description.getType() != XmlRpc::XmlRpcValue::TypeStruct || !description.hasMember("name") ||
+        !description.hasMember("type"))
+      return false;
+
+    hosted.name = ros::names::resolve(static_cast<std::string&>(description["name"]));
+    hosted.type = static_cast<std::string&>(description["type"]);
+
+    hosted.rate = 0;
+    if (description.hasMember("rate"))
+    {
+      XmlRpc::XmlRpcValue& rate = description["rate"];
+      if (rate.getType() == XmlRpc::XmlRpcValue::TypeInt)
+        hosted.rate = static_cast<int&>(rate);
+      else
+        hosted.rate = static_cast<double&>(rate);
+    }
+
+    hosted.autostart = description.hasMember("autostart") && static_cast<bool&>(description["autostart"]);
+    hosted.chained = false;
+
+    if (description.hasMember("remap"))
+    {
+      XmlRpc::XmlRpcValue& remap = description["remap"];
+      if (remap.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+        return false;
+      for (XmlRpc::XmlRpcValue::iterator it = remap.begin(); it != remap.end(); ++it)
+        hosted.remappings[it->first] = static_cast<std::string&>(it->second);
+    }
+    return true;
+  }
+  catch (XmlRpc::XmlRpcException&)
+  {
+    return false;
+  }
+}
+/*!********************************************************************************************************************
+ * Reads an element of '~chains', with a 'name', a 'rate' and the list of the names of its 'processes', in order of
+ * execution, and adds the chain to 'chains'. Returns false if it is not valid or a process is not hosted or already
+ * chained.
+ *********************************************************************************************************************/
+bool readChain(XmlRpc::XmlRpcValue& description, std::vector<std::unique_ptr<HostedProcess>>& processes,
+               std::vector<std::pair<std::unique_ptr<ProcessChain>, double>>& chains)
+{
+  try
+  {
+    if (description.getType() != XmlRpc::XmlRpcValue::TypeStruct || !description.hasMember("name") ||
+        !description.hasMember("rate") || !description.hasMember("processes") ||
+        description["processes"].getType() != XmlRpc::XmlRpcValue::TypeArray)
+      return false;
+
+    XmlRpc::XmlRpcValue& rate = description["rate"];
+    const double chain_rate =
+        rate.getType() == XmlRpc::XmlRpcValue::TypeInt ? static_cast<int&>(rate) : static_cast<double&>(rate);
+    if (chain_rate <= 0)
+      return false;
+
+    std::vector<HostedProcess*> stages;
+    XmlRpc::XmlRpcValue& names = description["processes"];
+    for (int i = 0; i < names.size(); i++)
+    {
+      const std::string name = ros::names::resolve(static_cast<std::string&>(names[i]));
+      std::vector<std::unique_ptr<HostedProcess>>::iterator hosted =
+          std::find_if(processes.begin(), processes.end(),
+                       [&name](const std::unique_ptr<HostedProcess>& process) { return process->name == name; });
+      if (hosted == processes.end() || (*hosted)->chained ||
+          std::find(stages.begin(), stages.end(), hosted->get()) != stages.end())
+        return false;
+      stages.push_back(hosted->get());
+    }
+
+    std::unique_ptr<ProcessChain> chain(new ProcessChain(static_cast<std::string&>(description["name"])));
+    for (HostedProcess* stage : stages)
+    {
+      stage->chained = true;
+      chain->addStage(*stage->process);
+    }
+    chains.push_back(std::make_pair(std::move(chain), chain_rate));
+    return true;
+  }
+  catch (XmlRpc::XmlRpcException&)
+  {
+    return false;
+  }
+}
+}  // namespace
+
+/*!********************************************************************************************************************
+ * Usage: robot_process_container
+ * Loads the RobotProcess plugins listed in '~processes' and hosts them in this node. Every process has its own name,
+ * parameters, services and topics, as if it were a node of its own, and the messages published as shared pointers
+ * are passed to the subscribers of the other processes without being serialized. For example:
+ * \code
+ * processes:
+ *   - {name: imu_filter, type: my_package/ImuFilterProcess, rate: 100, autostart: true, remap: {imu: /drone1/imu}}
+ *   - {name: state_estimator, type: my_package/StateEstimatorProcess, rate: 50}
+ * \endcode
+ * Processes with a rate are executed by runAtRate() in a thread of their own, or by the '~executor_threads' threads of
+ * a RunExecutor when it is positive, and the rest only serve their callbacks in a thread of their own.
+ * The callbacks of node handles not obtained from the processes are served by '~spinner_threads' threads.
+ * Pipelines of processes can be listed in '~chains', each executed as a ProcessChain at its own rate, in a thread or
+ * by the RunExecutor, and the messages of their ChainOutputs are handed over to the ChainInputs of the next stages:
+ * \code
+ * chains:
+ *   - {name: control, rate: 100, processes: [imu_filter, state_estimator]}
+ * \endcode
+ * The rate of a chained process is ignored.
+ *********************************************************************************************************************/
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "robot_process_container");
+  ros::NodeHandle private_handle("~");
+
+  XmlRpc::XmlRpcValue descriptions;
+  if (!private_handle.getParam("processes", descriptions) ||
+      descriptions.getType() != XmlRpc::XmlRpcValue::TypeArray)
+  {
+    ROS_FATAL("Container %s needs the list of its processes in ~processes", ros::this_node::getName().c_str());
+    return 1;
+  }
+
+  // The processes are declared after the loader, so they are destroyed before their libraries are unloaded.
+  pluginlib::ClassLoader<RobotProcess> loader("robot_process", "RobotProcess");
+  std::vector<std::unique_ptr<HostedProcess>> processes;
+
+  for (int i = 0; i < descriptions.size(); i++)
+  {
+    std::unique_ptr<HostedProcess> hosted(new HostedProcess());
+    if (!readDescription(descriptions[i], *hosted))
+    {
+      ROS_ERROR("Container %s ignores the element %d of ~processes, it needs a name and a type",
+                ros::this_node::getName().c_str(), i);
+      continue;
+    }
+
+    try
+    {
+      hosted->process = loader.createInstance(hosted->type);
+    }
+    catch (pluginlib::PluginlibException& error)
+    {
+      ROS_ERROR("Container %s could not load the process %s of type %s: %s", ros::this_node::getName().c_str(),
+                hosted->name.c_str(), hosted->type.c_str(), error.what());
+      continue;
+    }
+
+    hosted->process->setTransport(std::make_shared<RosTransport>(hosted->name, hosted->remappings));
+    hosted->process->setUp();
+    if (hosted->autostart)
+      hosted->process->start();
+    processes.push_back(std::move(hosted));
+  }
+
+  std::vector<std::pair<std::unique_ptr<ProcessChain>, double>> chains;
+  XmlRpc::XmlRpcValue chain_descriptions;
+  if (private_handle.getParam("chains", chain_descriptions))
+  {
+    for (int i = 0; chain_descriptions.getType() == XmlRpc::XmlRpcValue::TypeArray && i < chain_descriptions.size();
+         i++)
+    {
+      if (!readChain(chain_descriptions[i], processes, chains))
+      {
+        ROS_ERROR("Container %s ignores the element %d of ~chains, it needs a name, a positive rate and hosted "
+                  "processes that are not in other chains",
+                  ros::this_node::getName().c_str(), i);
+        continue;
+      }
+      ProcessChain& chain = *chains.back().first;
+      ROS_INFO("Container %s fused %lu connections of the chain %s", ros::this_node::getName().c_str(),
+               static_cast<unsigned long>(chain.fuse()), chain.getName().c_str());
+    }
+  }
+
+  int spinner_threads;
+  private_handle.param("spinner_threads", spinner_threads, 1);
+  ros::AsyncSpinner spinner(std::max(spinner_threads, 1));
+  spinner.start();
+
+  int executor_threads;
+  private_handle.param("executor_threads", executor_threads, 0);
+  RunExecutor executor;
+
+  for (std::unique_ptr<HostedProcess>& hosted : processes)
+  {
+    RobotProcess* process = hosted->process.get();
+    const double rate = hosted->rate;
+    if (hosted->chained)
+      continue;
+    if (rate > 0 && executor_threads > 0)
+      executor.addProcess(*process, rate);
+    else
+      hosted->loop = std::thread([process, rate]() {
+        if (rate > 0)
+          process->runAtRate(rate);
+        else
+          process->getTransport()->spin();
+      });
+  }
+
+  std::vector<std::thread> chain_loops;
+  for (std::pair<std::unique_ptr<ProcessChain>, double>& chain : chains)
+  {
+    if (executor_threads > 0)
+      chain.first->addTo(executor, chain.second);
+    else
+      chain_loops.push_back(std::thread(&ProcessChain::runAtRate, chain.first.get(), chain.second));
+  }
+
+  // The releases follow the clock of the processes, which share the one selected by their '~clock' parameter.
+  if (executor_threads > 0 && !processes.empty())
+  {
+    executor.setClock(processes.front()->process->getClock());
+    executor.start(executor_threads);
+  }
+
+  ros::waitForShutdown();
+  executor.stop();
+  for (std::unique_ptr<HostedProcess>& hosted : processes)
+    if (hosted->loop.joinable())
+      hosted->loop.join();
+  for (std::thread& loop : chain_loops)
+    loop.join();
+
+  // The plugins may not call shutdown() from their destructors, so their threads are stopped while they still exist.
+  for (std::unique_ptr<HostedProcess>& hosted : processes)
+    hosted->process->shutdown();
+
+  for (const RunExecutor::JobStatistics& job : executor.getStatistics())
+    ROS_INFO("Container %s executed %s %lu times at %.1f Hz: mean %.3f ms, max %.3f ms, max lateness %.3f ms, "
+             "%lu overruns, %lu skipped releases",
+             ros::this_node::getName().c_str(), job.name.c_str(), static_cast<unsigned long>(job.runs), job.rate,
+             job.mean_duration_ns / 1e6, job.max_duration_ns / 1e6, job.max_lateness_ns / 1e6,
+             static_cast<unsigned long>(job.overruns), static_cast<unsigned long>(job.skipped_releases));
+  return 0;
+}
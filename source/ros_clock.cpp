@@ -0,0 +1,72 @@
+/*!*******************************************************************************************
+ *  \file       ros_clock.cpp
+ *  \brief      RosClock implementation file.
+ *  \details    This file implements the RosClock class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+
+#include "../include/ros_clock.h"
+
+namespace
+{
+// Ticks that can be waiting for the loops in lockstep before the oldest ones are dropped.
+const uint32_t CLOCK_QUEUE_SIZE = 1000;
+}  // namespace
+
+RosClock::RosClock() : clock_thread_active(true)
+{
+  node_handle.setCallbackQueue(&clock_queue);
+  clock_sub = node_handle.subscribe("/clock", CLOCK_QUEUE_SIZE, &RosClock::clockCallback, this,
+                                    ros::TransportHints().tcpNoDelay());
+  clock_thread = std::thread(&RosClock::clockThread, this);
+}
+
+RosClock::~RosClock()
+{
+  clock_sub.shutdown();
+  clock_thread_active = false;
+  if (clock_thread.joinable())
+    clock_thread.join();
+}
+
+void RosClock::clockThread()
+{
+  while (clock_thread_active && ros::ok())
+    clock_queue.callAvailable(ros::WallDuration(0.1));
+}
+
+void RosClock::clockCallback(const rosgraph_msgs::Clock::ConstPtr& message)
+{
+  advanceTo(static_cast<int64_t>(message->clock.toNSec()));
+}
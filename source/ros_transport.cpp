@@ -0,0 +1,364 @@
+/*!*******************************************************************************************
+ *  \file       ros_transport.cpp
+ *  \brief      RosTransport implementation file.
+ *  \details    This file implements the RosTransport class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/ros_transport.h"
+
+#include "../include/allocation_profiler.h"
+#include "../include/tracer.h"
+
+namespace
+{
+// Longest time a service thread waits for requests. shutdown() wakes it up at once, this only bounds how late it
+// notices that ROS was shut down.
+const double SERVICE_WAIT_TIMEOUT = 1.0;
+}  // namespace
+
+RosTransport::RosTransport() : name(ros::this_node::getName()), hosted(false), service_threads_active(false)
+{
+}
+
+RosTransport::RosTransport(const std::string& process_name,
+                           const std::map<std::string, std::string>& process_remappings)
+  : name(process_name)
+  , hosted(true)
+  , remappings(process_remappings)
+  , service_threads_active(false)
+{
+}
+
+RosTransport::~RosTransport()
+{
+  shutdown();
+}
+
+std::string RosTransport::processName() const
+{
+  return name;
+}
+
+void RosTransport::param(const std::string& param_name, bool& value, bool default_value)
+{
+  ros::param::param<bool>(paramName(param_name), value, default_value);
+}
+
+void RosTransport::param(const std::string& param_name, int& value, int default_value)
+{
+  ros::param::param<int>(paramName(param_name), value, default_value);
+}
+
+void RosTransport::param(const std::string& param_name, double& value, double default_value)
+{
+  ros::param::param<double>(paramName(param_name), value, default_value);
+}
+
+void RosTransport::param(const std::string& param_name, std::string& value, const std::string& default_value)
+{
+  ros::param::param<std::string>(paramName(param_name), value, default_value);
+}
+
+void RosTransport::param(const std::string& param_name, std::vector<int>& value, const std::vector<int>& default_value)
+{
+  ros::param::param<std::vector<int>>(paramName(param_name), value, default_value);
+}
+
+void RosTransport::advertise(const ProcessRequestHandlers& process_handlers)
+{
+  handlers = process_handlers;
+
+  node_handle_lifecycle.setCallbackQueue(&lifecycle_queue);
+  stop_server_srv = node_handle_lifecycle.advertiseService(name + "/stop", &RosTransport::stopSrvCall, this);
+  start_server_srv = node_handle_lifecycle.advertiseService(name + "/start", &RosTransport::startSrvCall, this);
+  pause_server_srv = node_handle_lifecycle.advertiseService(name + "/pause", &RosTransport::pauseSrvCall, this);
+  resume_server_srv = node_handle_lifecycle.advertiseService(name + "/resume", &RosTransport::resumeSrvCall, this);
+  dump_trace_srv = node_handle_lifecycle.advertiseService(name + "/dump_trace", &RosTransport::dumpTraceSrvCall, this);
+
+  node_handle_query.setCallbackQueue(&query_queue);
+  is_running_srv = node_handle_query.advertiseService(name + "/is_running", &RosTransport::isRunningSrvCall, this);
+  get_status_srv = node_handle_query.advertiseService(name + "/get_status", &RosTransport::getStatusSrvCall, this);
+
+  state_event_pub = node_handle.advertise<robot_process::StateEvent>(name + "/state_event", 10, true);
+
+  heartbeat_pub = node_handle.advertise<robot_process::ProcessHeartbeat>(name + "/state", 1, true);
+
+  metrics_pub = node_handle.advertise<robot_process::RunMetrics>(name + "/metrics", 10);
+}
+
+void RosTransport::startServing(int data_threads)
+{
+  service_threads_active = true;
+  lifecycle_queue.enable();
+  query_queue.enable();
+  lifecycle_thread = std::thread(&RosTransport::serviceThread, this, &lifecycle_queue);
+  query_thread = std::thread(&RosTransport::serviceThread, this, &query_queue);
+
+  if (data_threads > 0)
+  {
+    data_spinner.reset(new ros::AsyncSpinner(data_threads, hosted ? &data_queue : nullptr));
+    data_spinner->start();
+  }
+}
+
+void RosTransport::shutdown()
+{
+  if (data_spinner)
+    data_spinner->stop();
+
+  start_server_srv.shutdown();
+  stop_server_srv.shutdown();
+  pause_server_srv.shutdown();
+  resume_server_srv.shutdown();
+  dump_trace_srv.shutdown();
+
+  is_running_srv.shutdown();
+  get_status_srv.shutdown();
+
+  service_threads_active = false;
+  lifecycle_queue.disable();
+  query_queue.disable();
+  if (lifecycle_thread.joinable())
+    lifecycle_thread.join();
+  if (query_thread.joinable())
+    query_thread.join();
+}
+
+void RosTransport::serviceThread(ros::CallbackQueue* queue)
+{
+  ROBOT_PROCESS_ALLOCATION_PHASE(CALLBACK);
+  while (service_threads_active && ros::ok())
+    queue->callAvailable(ros::WallDuration(SERVICE_WAIT_TIMEOUT));
+}
+
+void RosTransport::publishStateChange(const ProcessStateChange& change)
+{
+  if (!state_event_pub)
+    return;
+
+  robot_process::StateEvent event;
+  event.stamp = ros::Time::now();
+  event.process_name = name;
+  event.previous_state = processStateIndex(change.previous_state);
+  event.state = processStateIndex(change.state);
+  event.state_name = processStateName(change.state);
+  state_event_pub.publish(event);
+}
+
+void RosTransport::publishHeartbeat(const ProcessHeartbeatInfo& heartbeat_info)
+{
+  if (!heartbeat_pub)
+    return;
+
+  robot_process::ProcessHeartbeat heartbeat;
+  heartbeat.seq = heartbeat_info.seq;
+  heartbeat.stamp = ros::Time::now();
+  heartbeat.hostname = heartbeat_info.hostname;
+  heartbeat.drone_id = heartbeat_info.drone_id;
+  heartbeat.process_name = name;
+  heartbeat.state = processStateIndex(heartbeat_info.state);
+  heartbeat.state_name = processStateName(heartbeat_info.state);
+  heartbeat_pub.publish(heartbeat);
+}
+
+void RosTransport::publishMetrics(const ProcessMetrics& process_metrics)
+{
+  if (!metrics_pub)
+    return;
+
+  robot_process::RunMetrics metrics;
+  metrics.stamp = ros::Time::now();
+  metrics.process_name = name;
+  metrics.cycles = process_metrics.cycles;
+  metrics.total_cycles = process_metrics.total_cycles;
+  metrics.p50_ns = process_metrics.p50_ns;
+  metrics.p90_ns = process_metrics.p90_ns;
+  metrics.p99_ns = process_metrics.p99_ns;
+  metrics.p999_ns = process_metrics.p999_ns;
+  metrics.max_ns = process_metrics.max_ns;
+  metrics.arena_high_water_bytes = process_metrics.arena_high_water_bytes;
+  metrics.arena_capacity_bytes = process_metrics.arena_capacity_bytes;
+  metrics_pub.publish(metrics);
+}
+
+bool RosTransport::ok() const
+{
+  return ros::ok();
+}
+
+void RosTransport::spinOnce()
+{
+  if (data_spinner)
+    return;
+
+  if (hosted)
+    data_queue.callAvailable();
+  else
+    ros::spinOnce();
+}
+
+void RosTransport::spin()
+{
+  if (data_spinner)
+  {
+    ros::waitForShutdown();
+  }
+  else if (hosted)
+  {
+    while (ros::ok())
+      data_queue.callAvailable(ros::WallDuration(0.1));
+  }
+  else
+  {
+    ros::spin();
+  }
+}
+
+ros::NodeHandle RosTransport::nodeHandle()
+{
+  if (!hosted)
+    return ros::NodeHandle();
+
+  ros::NodeHandle handle(ros::names::parentNamespace(name), remappings);
+  handle.setCallbackQueue(&data_queue);
+  return handle;
+}
+
+ros::NodeHandle RosTransport::privateNodeHandle()
+{
+  if (!hosted)
+    return ros::NodeHandle("~");
+
+  ros::NodeHandle handle(name, remappings);
+  handle.setCallbackQueue(&data_queue);
+  return handle;
+}
+
+std::string RosTransport::paramName(const std::string& param_name) const
+{
+  return hosted ? name + "/" + param_name : "~" + param_name;
+}
+
+bool RosTransport::stopSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response)
+{
+  ROBOT_PROCESS_TRACE_SCOPE("RobotProcess::stopSrvCall");
+
+  if (handlers.stop())
+  {
+    return true;
+  }
+  else
+  {
+    ROS_WARN("Node %s received a stop call when it was already stopped", name.c_str());
+    return false;
+  }
+}
+
+bool RosTransport::startSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response)
+{
+  ROBOT_PROCESS_TRACE_SCOPE("RobotProcess::startSrvCall");
+
+  if (handlers.start())
+  {
+    return true;
+  }
+  else
+  {
+    ROS_WARN("Node %s received a start call when it was already running", name.c_str());
+    return false;
+  }
+}
+
+bool RosTransport::pauseSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response)
+{
+  ROBOT_PROCESS_TRACE_SCOPE("RobotProcess::pauseSrvCall");
+
+  if (handlers.pause())
+  {
+    return true;
+  }
+  else
+  {
+    ROS_WARN("Node %s received a pause call when it was not running", name.c_str());
+    return false;
+  }
+}
+
+bool RosTransport::resumeSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response)
+{
+  ROBOT_PROCESS_TRACE_SCOPE("RobotProcess::resumeSrvCall");
+
+  if (handlers.resume())
+  {
+    return true;
+  }
+  else
+  {
+    ROS_WARN("Node %s received a resume call when it was not paused", name.c_str());
+    return false;
+  }
+}
+
+bool RosTransport::isRunningSrvCall(std_srvs::Trigger::Request& request, std_srvs::Trigger::Response& response)
+{
+  ROBOT_PROCESS_TRACE_SCOPE("RobotProcess::isRunningSrvCall");
+
+  const ProcessState state = handlers.get_state();
+  response.success = state == ProcessState::RUNNING;
+  response.message = processStateName(state);
+  return true;
+}
+
+bool RosTransport::getStatusSrvCall(robot_process::GetProcessStatus::Request& request,
+                                    robot_process::GetProcessStatus::Response& response)
+{
+  ROBOT_PROCESS_TRACE_SCOPE("RobotProcess::getStatusSrvCall");
+
+  const ProcessStatus status = handlers.get_status();
+  response.state = processStateIndex(status.state);
+  response.state_name = processStateName(status.state);
+  response.uptime = status.uptime;
+  response.cycles = status.cycles;
+  response.missed_deadlines = status.missed_deadlines;
+  response.last_run_duration_ns = status.last_run_duration_ns;
+  response.max_run_duration_ns = status.max_run_duration_ns;
+  response.mean_run_duration_ns = status.mean_run_duration_ns;
+  response.max_jitter_ns = status.max_jitter_ns;
+  return true;
+}
+
+bool RosTransport::dumpTraceSrvCall(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response)
+{
+  return handlers.dump_trace();
+}
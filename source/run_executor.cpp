@@ -0,0 +1,257 @@
+/*!*******************************************************************************************
+ *  \file       run_executor.cpp
+ *  \brief      RunExecutor implementation file.
+ *  \details    This file implements the RunExecutor class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+
+#include "../include/run_executor.h"
+#include "../include/robot_process.h"
+
+#include <algorithm>
+#include <time.h>
+
+namespace
+{
+int64_t monotonicNow()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+}  // namespace
+
+const RunExecutor::JobId RunExecutor::INVALID_JOB;
+
+RunExecutor::RunExecutor() : active(false), clock(std::make_shared<RealClock>()), clock_listener(0)
+{
+}
+
+RunExecutor::~RunExecutor()
+{
+  stop();
+}
+
+void RunExecutor::setClock(const std::shared_ptr<ProcessClock>& executor_clock)
+{
+  clock = executor_clock;
+}
+
+RunExecutor::JobId RunExecutor::addProcess(RobotProcess& process, double rate)
+{
+  RobotProcess* executed = &process;
+  return addJob(process.processName(), rate,
+                [executed](int64_t release_ns) { executed->runScheduledCycle(release_ns); }, executed);
+}
+
+RunExecutor::JobId RunExecutor::addJob(const std::string& name, double rate, const std::function<void()>& function)
+{
+  return addJob(name, rate, [function](int64_t) { function(); }, nullptr);
+}
+
+RunExecutor::JobId RunExecutor::addReleasedJob(const std::string& name, double rate,
+                                               const std::function<void(int64_t)>& function)
+{
+  return addJob(name, rate, function, nullptr);
+}
+
+RunExecutor::JobId RunExecutor::addJob(const std::string& name, double rate,
+                                       const std::function<void(int64_t)>& function, RobotProcess* process)
+{
+  if (rate <= 0)
+    return INVALID_JOB;
+
+  std::unique_ptr<Job> job(new Job());
+  job->statistics.name = name;
+  job->statistics.rate = rate;
+  job->statistics.runs = 0;
+  job->statistics.overruns = 0;
+  job->statistics.skipped_releases = 0;
+  job->statistics.last_duration_ns = 0;
+  job->statistics.max_duration_ns = 0;
+  job->statistics.mean_duration_ns = 0;
+  job->statistics.max_lateness_ns = 0;
+  job->function = function;
+  job->process = process;
+  job->period_ns = static_cast<int64_t>(1e9 / rate);
+  job->release_ns = 0;
+  job->total_duration_ns = 0;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  jobs.push_back(std::move(job));
+  return static_cast<JobId>(jobs.size() - 1);
+}
+
+namespace
+{
+// Orders the heaps so their front is the job with the earliest deadline or release.
+struct LaterDeadline
+{
+  template <class Job>
+  bool operator()(const Job* a, const Job* b) const
+  {
+    return a->release_ns + a->period_ns > b->release_ns + b->period_ns;
+  }
+};
+
+struct LaterRelease
+{
+  template <class Job>
+  bool operator()(const Job* a, const Job* b) const
+  {
+    return a->release_ns > b->release_ns;
+  }
+};
+}  // namespace
+
+void RunExecutor::start(unsigned int threads, const RealtimeConfig& config)
+{
+  stop();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    active = true;
+    ready.clear();
+    waiting.clear();
+    const int64_t now = clock->now();
+    for (std::unique_ptr<Job>& job : jobs)
+    {
+      if (job->process != nullptr)
+        job->process->beginScheduledRuns(job->statistics.rate);
+      job->release_ns = now;
+      waiting.push_back(job.get());
+    }
+    std::make_heap(waiting.begin(), waiting.end(), LaterRelease());
+  }
+  clock_listener = clock->addAdvanceListener([this]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    condition.notify_all();
+  });
+
+  for (unsigned int i = 0; i < threads; i++)
+  {
+    std::unique_ptr<RealtimeThread> thread(new RealtimeThread());
+    if (thread->start(config, [this]() { worker(); }))
+      workers.push_back(std::move(thread));
+  }
+}
+
+void RunExecutor::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    active = false;
+  }
+  condition.notify_all();
+  for (std::unique_ptr<RealtimeThread>& thread : workers)
+    thread->join();
+  workers.clear();
+  if (clock_listener != 0)
+  {
+    clock->removeAdvanceListener(clock_listener);
+    clock_listener = 0;
+  }
+}
+
+std::vector<RunExecutor::JobStatistics> RunExecutor::getStatistics() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<JobStatistics> statistics;
+  for (const std::unique_ptr<Job>& job : jobs)
+    statistics.push_back(job->statistics);
+  return statistics;
+}
+
+void RunExecutor::worker()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (active)
+  {
+    const int64_t now = clock->now();
+    while (!waiting.empty() && waiting.front()->release_ns <= now)
+    {
+      std::pop_heap(waiting.begin(), waiting.end(), LaterRelease());
+      ready.push_back(waiting.back());
+      waiting.pop_back();
+      std::push_heap(ready.begin(), ready.end(), LaterDeadline());
+    }
+
+    if (ready.empty())
+    {
+      if (waiting.empty())
+        condition.wait(lock);
+      else
+        clock->waitUntil(lock, condition, waiting.front()->release_ns);
+      continue;
+    }
+
+    std::pop_heap(ready.begin(), ready.end(), LaterDeadline());
+    Job* selected = ready.back();
+    const int64_t release_ns = selected->release_ns;
+    ready.pop_back();
+    // Another thread may take the next released job while this one executes the selected job.
+    if (!ready.empty())
+      condition.notify_one();
+    lock.unlock();
+
+    const int64_t start_clock_ns = clock->now();
+    const int64_t start_ns = monotonicNow();
+    selected->function(release_ns);
+    const int64_t end_ns = monotonicNow();
+    const int64_t end_clock_ns = clock->now();
+
+    lock.lock();
+    JobStatistics& statistics = selected->statistics;
+    const int64_t duration_ns = end_ns - start_ns;
+    statistics.runs++;
+    statistics.last_duration_ns = duration_ns;
+    statistics.max_duration_ns = std::max(statistics.max_duration_ns, duration_ns);
+    statistics.max_lateness_ns = std::max(statistics.max_lateness_ns, start_clock_ns - release_ns);
+    selected->total_duration_ns += duration_ns;
+    statistics.mean_duration_ns = selected->total_duration_ns / static_cast<int64_t>(statistics.runs);
+
+    // The deadline of a release is the next one. The releases that expire before the execution finishes are skipped,
+    // as runAtRate() skips its periods, so the job keeps its phase and is never executed late for an expired release.
+    const int64_t deadline_ns = release_ns + selected->period_ns;
+    const int64_t skipped = ProcessClock::expiredPeriods(end_clock_ns, deadline_ns, selected->period_ns);
+    if (skipped > 0)
+    {
+      statistics.overruns++;
+      statistics.skipped_releases += skipped;
+    }
+    selected->release_ns = deadline_ns + skipped * selected->period_ns;
+    waiting.push_back(selected);
+    std::push_heap(waiting.begin(), waiting.end(), LaterRelease());
+    condition.notify_one();
+  }
+}
@@ -0,0 +1,322 @@
+/*!*******************************************************************************************
+ *  \file       tracer.cpp
+ *  \brief      Tracer implementation file.
+ *  \details    This file implements the Tracer class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/tracer.h"
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace
+{
+struct TraceEvent
+{
+  const char* name;
+  int64_t begin;
+  int64_t end;
+};
+
+//! Simultaneous readings of the trace clock and CLOCK_MONOTONIC.
+struct ClockReading
+{
+  int64_t trace_time;
+  int64_t monotonic_ns;
+
+  static ClockReading take()
+  {
+    timespec time;
+    ClockReading reading;
+    reading.trace_time = Tracer::now();
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    reading.monotonic_ns = static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+    return reading;
+  }
+};
+
+// Reading taken when the first buffer is created. Together with a reading taken when the trace is written, it gives
+// the conversion from trace clock to CLOCK_MONOTONIC.
+ClockReading first_reading;
+bool first_reading_taken = false;
+
+struct ThreadBuffer
+{
+  explicit ThreadBuffer(uint32_t buffer_capacity) : capacity(buffer_capacity), events(new TraceEvent[buffer_capacity])
+  {
+  }
+
+  int32_t tid;                           //!< Kernel id of the thread.
+  char thread_name[16];                  //!< Name of the thread when it took the buffer.
+  bool retired;                          //!< True once the thread has finished, until its events are written.
+  std::atomic<uint64_t> count;           //!< Number of events recorded by the thread.
+  const uint32_t capacity;               //!< Number of events kept, a power of two.
+  std::unique_ptr<TraceEvent[]> events;  //!< Ring buffer of the last events.
+};
+
+// Buffers of the running threads and of the finished ones whose events have not been written yet, and buffers ready
+// for new threads. A thread takes its buffer the first time it records an event or calls registerThread(). The free
+// buffers always have the configured capacity.
+std::mutex buffers_mutex;
+std::vector<ThreadBuffer*> buffers;
+std::vector<ThreadBuffer*> free_buffers;
+uint32_t configured_events_per_thread = Tracer::DEFAULT_EVENTS_PER_THREAD;
+uint32_t configured_preallocated_buffers = Tracer::DEFAULT_PREALLOCATED_BUFFERS;
+
+thread_local ThreadBuffer* thread_buffer = nullptr;
+thread_local bool thread_exiting = false;
+
+ThreadBuffer* takeBuffer()
+{
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  ThreadBuffer* buffer = nullptr;
+  if (!free_buffers.empty())
+  {
+    buffer = free_buffers.back();
+    free_buffers.pop_back();
+  }
+  else
+  {
+    // Without free buffers, the oldest retired buffer is reused before allocating, so the buffers of short lived
+    // threads do not accumulate when the trace is never written.
+    size_t retired = 0;
+    for (ThreadBuffer* candidate : buffers)
+      retired += candidate->retired ? 1 : 0;
+    if (retired >= Tracer::MAX_RETIRED_BUFFERS)
+    {
+      for (size_t i = 0; i < buffers.size() && buffer == nullptr; i++)
+      {
+        if (buffers[i]->retired)
+        {
+          buffer = buffers[i];
+          buffers.erase(buffers.begin() + i);
+        }
+      }
+      if (buffer->capacity != configured_events_per_thread)
+      {
+        delete buffer;
+        buffer = nullptr;
+      }
+    }
+    if (buffer == nullptr)
+      buffer = new ThreadBuffer(configured_events_per_thread);
+  }
+
+  buffer->tid = static_cast<int32_t>(syscall(SYS_gettid));
+  buffer->thread_name[0] = '\0';
+  pthread_getname_np(pthread_self(), buffer->thread_name, sizeof buffer->thread_name);
+  buffer->retired = false;
+  buffer->count.store(0, std::memory_order_relaxed);
+
+  if (!first_reading_taken)
+  {
+    first_reading = ClockReading::take();
+    first_reading_taken = true;
+  }
+  buffers.push_back(buffer);
+  return buffer;
+}
+
+//! Retires the buffer of a thread when it finishes. Its events are kept until the trace is written.
+struct BufferRetirement
+{
+  ~BufferRetirement()
+  {
+    thread_exiting = true;
+    if (thread_buffer == nullptr)
+      return;
+
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    thread_buffer->retired = true;
+    thread_buffer = nullptr;
+  }
+};
+
+ThreadBuffer* threadBuffer()
+{
+  if (thread_buffer == nullptr && !thread_exiting)
+  {
+    thread_buffer = takeBuffer();
+    static thread_local BufferRetirement retirement;
+    (void)retirement;
+  }
+  return thread_buffer;
+}
+
+void writeJsonString(FILE* file, const char* text)
+{
+  fputc('"', file);
+  for (const char* c = text; *c != '\0'; c++)
+  {
+    if (*c == '"' || *c == '\\')
+      fputc('\\', file);
+    if (static_cast<unsigned char>(*c) >= 0x20)
+      fputc(*c, file);
+  }
+  fputc('"', file);
+}
+}  // namespace
+
+void Tracer::configure(uint32_t events_per_thread, uint32_t preallocated_buffers)
+{
+  uint32_t capacity = 1;
+  while (capacity < events_per_thread && capacity < 0x80000000u)
+    capacity <<= 1;
+
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  configured_events_per_thread = capacity;
+  configured_preallocated_buffers = preallocated_buffers;
+  for (ThreadBuffer* buffer : free_buffers)
+    delete buffer;
+  free_buffers.clear();
+}
+
+void Tracer::setEnabled(bool enabled)
+{
+  if (enabled)
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    while (buffers.size() + free_buffers.size() < configured_preallocated_buffers)
+      free_buffers.push_back(new ThreadBuffer(configured_events_per_thread));
+  }
+  enabled_flag().store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::registerThread()
+{
+  if (isEnabled())
+    threadBuffer();
+}
+
+void Tracer::record(const char* name, int64_t begin, int64_t end)
+{
+  ThreadBuffer* buffer = threadBuffer();
+  if (buffer == nullptr)
+    return;
+  const uint64_t count = buffer->count.load(std::memory_order_relaxed);
+  TraceEvent& event = buffer->events[count & (buffer->capacity - 1)];
+  event.name = name;
+  event.begin = begin;
+  event.end = end;
+  buffer->count.store(count + 1, std::memory_order_release);
+}
+
+bool Tracer::writeChromeTrace(const std::string& path)
+{
+  FILE* file = fopen(path.c_str(), "w");
+  if (file == nullptr)
+    return false;
+
+  const int pid = getpid();
+  bool first = true;
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  const ClockReading last_reading = ClockReading::take();
+  double ns_per_tick = 1.0;
+  if (last_reading.trace_time > first_reading.trace_time)
+    ns_per_tick = static_cast<double>(last_reading.monotonic_ns - first_reading.monotonic_ns) /
+                  (last_reading.trace_time - first_reading.trace_time);
+
+  for (ThreadBuffer* buffer : buffers)
+  {
+    fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+            first ? "" : ",", pid, buffer->tid);
+    writeJsonString(file, buffer->thread_name);
+    fprintf(file, "}}");
+    first = false;
+
+    const uint64_t count = buffer->count.load(std::memory_order_acquire);
+    const uint64_t oldest = count > buffer->capacity ? count - buffer->capacity : 0;
+    for (uint64_t i = oldest; i < count; i++)
+    {
+      const TraceEvent& event = buffer->events[i & (buffer->capacity - 1)];
+      fprintf(file, ",\n{\"name\":");
+      writeJsonString(file, event.name);
+      const double begin_ns = first_reading.monotonic_ns + (event.begin - first_reading.trace_time) * ns_per_tick;
+      fprintf(file, ",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", pid, buffer->tid,
+              begin_ns / 1000.0, (event.end - event.begin) * ns_per_tick / 1000.0);
+    }
+  }
+
+  fprintf(file, "\n]}\n");
+
+  // The events of the finished threads have been written, so their buffers can be used by new threads.
+  for (size_t i = 0; i < buffers.size();)
+  {
+    if (buffers[i]->retired)
+    {
+      if (buffers[i]->capacity == configured_events_per_thread)
+        free_buffers.push_back(buffers[i]);
+      else
+        delete buffers[i];
+      buffers.erase(buffers.begin() + i);
+    }
+    else
+      i++;
+  }
+  return fclose(file) == 0;
+}
+
+bool Tracer::hasInvariantTimeStampCounter()
+{
+  // Without constant_tsc the counter follows the frequency of the core, and without nonstop_tsc it stops in the deep
+  // sleep states, so it would not measure time.
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line))
+  {
+    if (line.compare(0, 5, "flags") != 0)
+      continue;
+
+    bool constant = false;
+    bool nonstop = false;
+    std::istringstream flags(line.substr(line.find(':') + 1));
+    std::string flag;
+    while (flags >> flag)
+    {
+      constant = constant || flag == "constant_tsc";
+      nonstop = nonstop || flag == "nonstop_tsc";
+    }
+    return constant && nonstop;
+  }
+  return false;
+}
@@ -0,0 +1,242 @@
+/*!*******************************************************************************************
+ *  \file       work_stealing_pool.cpp
+ *  \brief      WorkStealingPool implementation file.
+ *  \details    This file implements the WorkStealingPool class.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/work_stealing_pool.h"
+#include "../include/tracer.h"
+
+namespace
+{
+const int SPIN_ITERATIONS = 2000;  // Attempts to find a task before an unparked thread goes to sleep.
+
+// Index of the queue of the current thread, or -1 if it does not belong to a pool.
+thread_local int worker_queue = -1;
+thread_local const void* worker_pool = nullptr;
+}  // namespace
+
+// Ring of preallocated slots. The newest task is at 'tail - 1' and the oldest at 'head'.
+struct WorkStealingPool::Queue
+{
+  std::mutex mutex;
+  Job jobs[QUEUE_CAPACITY];
+  size_t head;
+  size_t tail;
+
+  Queue() : head(0), tail(0)
+  {
+  }
+};
+
+const size_t WorkStealingPool::QUEUE_CAPACITY;
+const size_t WorkStealingPool::Task::INLINE_SIZE;
+
+WorkStealingPool::WorkStealingPool()
+  : next_queue(0), queued_jobs(0), sleeping_workers(0), parked(true), active(false)
+{
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+  stop();
+}
+
+void WorkStealingPool::start(unsigned int threads)
+{
+  stop();
+
+  queues.clear();
+  for (unsigned int i = 0; i < threads; i++)
+    queues.push_back(std::unique_ptr<Queue>(new Queue()));
+  queued_jobs = 0;
+
+  active = true;
+  for (unsigned int i = 0; i < threads; i++)
+    workers.push_back(std::thread(&WorkStealingPool::worker, this, i));
+}
+
+void WorkStealingPool::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex);
+    active = false;
+  }
+  idle_condition.notify_all();
+  for (std::thread& worker : workers)
+    worker.join();
+  workers.clear();
+}
+
+void WorkStealingPool::submit(Job& job)
+{
+  job.group->pending.fetch_add(1, std::memory_order_relaxed);
+
+  const size_t index = worker_pool == this ? static_cast<size_t>(worker_queue) :
+                                             next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+  Queue& queue = *queues[index];
+  bool queued = false;
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tail - queue.head < QUEUE_CAPACITY)
+    {
+      queue.jobs[queue.tail % QUEUE_CAPACITY] = std::move(job);
+      queue.tail++;
+      queued_jobs.fetch_add(1);
+      queued = true;
+    }
+  }
+
+  // A full queue means that the threads are already busy, so the task is executed here instead of allocating more
+  // slots.
+  if (!queued)
+  {
+    execute(job);
+    return;
+  }
+
+  // The counters are sequentially consistent: either the sleeping thread sees the new task before waiting, or this
+  // thread sees it sleeping and wakes it up.
+  if (sleeping_workers.load() > 0)
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex);
+    idle_condition.notify_one();
+  }
+}
+
+bool WorkStealingPool::takeJob(size_t own, Job& job)
+{
+  if (queued_jobs.load(std::memory_order_relaxed) == 0)
+    return false;
+
+  for (size_t i = 0; i < queues.size(); i++)
+  {
+    Queue& queue = *queues[(own + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.head == queue.tail)
+      continue;
+
+    // The own queue is used as a stack, to keep its data in cache, and the others are stolen from the other end.
+    if (i == 0)
+    {
+      queue.tail--;
+      job = std::move(queue.jobs[queue.tail % QUEUE_CAPACITY]);
+    }
+    else
+    {
+      job = std::move(queue.jobs[queue.head % QUEUE_CAPACITY]);
+      queue.head++;
+    }
+    queued_jobs.fetch_sub(1);
+    return true;
+  }
+  return false;
+}
+
+void WorkStealingPool::execute(Job& job)
+{
+  job.function();
+  job.function.reset();
+
+  // The group can be destroyed as soon as its counter reaches zero, so it is not used after the decrement.
+  if (job.group->pending.fetch_sub(1) == 1 && sleeping_workers.load() > 0)
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex);
+    idle_condition.notify_all();
+  }
+}
+
+void WorkStealingPool::waitFor(TaskGroup& group)
+{
+  const size_t own = worker_pool == this ? static_cast<size_t>(worker_queue) : 0;
+  Job job;
+  int idle_iterations = 0;
+  while (group.pending.load() > 0)
+  {
+    if (takeJob(own, job))
+    {
+      execute(job);
+      idle_iterations = 0;
+      continue;
+    }
+
+    if (idle_iterations++ < SPIN_ITERATIONS)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // The remaining tasks of the group are being executed by other threads. The last one wakes this thread up, as
+    // does a new task, which could be a nested task of the group.
+    std::unique_lock<std::mutex> lock(idle_mutex);
+    sleeping_workers.fetch_add(1);
+    idle_condition.wait(lock, [this, &group]() { return group.pending.load() == 0 || queued_jobs.load() > 0; });
+    sleeping_workers.fetch_sub(1);
+    idle_iterations = 0;
+  }
+}
+
+void WorkStealingPool::worker(size_t index)
+{
+  worker_pool = this;
+  worker_queue = static_cast<int>(index);
+  Tracer::registerThread();
+
+  Job job;
+  int idle_iterations = 0;
+  while (active.load(std::memory_order_relaxed))
+  {
+    if (takeJob(index, job))
+    {
+      execute(job);
+      idle_iterations = 0;
+      continue;
+    }
+
+    if (!parked.load(std::memory_order_relaxed) && idle_iterations++ < SPIN_ITERATIONS)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(idle_mutex);
+    sleeping_workers.fetch_add(1);
+    idle_condition.wait(lock, [this]() { return !active || queued_jobs.load() > 0; });
+    sleeping_workers.fetch_sub(1);
+    idle_iterations = 0;
+  }
+
+  worker_pool = nullptr;
+  worker_queue = -1;
+}
@@ -0,0 +1,158 @@
+/*!*******************************************************************************************
+ *  \file       latency_histogram_test.cpp
+ *  \brief      Tests of LatencyHistogram.
+ *  \details    This file checks the edges of the buckets of LatencyHistogram and the percentiles of its
+ *              snapshots.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/latency_histogram.h"
+
+#include <memory>
+#include <gtest/gtest.h>
+
+TEST(LatencyHistogramTest, SmallValuesHaveTheirOwnBucket)
+{
+  for (int64_t value = 0; value < 2 * LatencyHistogram::SUB_BUCKET_COUNT; value++)
+  {
+    EXPECT_EQ(static_cast<uint32_t>(value), LatencyHistogram::bucketIndex(value));
+    EXPECT_EQ(value, LatencyHistogram::bucketHighestValue(LatencyHistogram::bucketIndex(value)));
+  }
+}
+
+TEST(LatencyHistogramTest, BucketsAreContiguousAndPrecise)
+{
+  for (uint32_t index = 2 * LatencyHistogram::SUB_BUCKET_COUNT; index < LatencyHistogram::BUCKET_COUNT; index++)
+  {
+    const int64_t lowest = LatencyHistogram::bucketHighestValue(index - 1) + 1;
+    const int64_t highest = LatencyHistogram::bucketHighestValue(index);
+    ASSERT_LE(lowest, highest) << "bucket " << index;
+    EXPECT_EQ(index, LatencyHistogram::bucketIndex(lowest)) << "bucket " << index;
+    EXPECT_EQ(index, LatencyHistogram::bucketIndex(highest)) << "bucket " << index;
+    if (index + 1 < LatencyHistogram::BUCKET_COUNT)
+    {
+      EXPECT_EQ(index + 1, LatencyHistogram::bucketIndex(highest + 1)) << "bucket " << index;
+    }
+
+    // Every value of a bucket is represented by its highest one with a relative error below 1 / SUB_BUCKET_COUNT.
+    EXPECT_LT((highest - lowest) * static_cast<int64_t>(LatencyHistogram::SUB_BUCKET_COUNT), lowest)
+        << "bucket " << index;
+  }
+}
+
+TEST(LatencyHistogramTest, LongValuesAreCountedInTheLastBucket)
+{
+  const int64_t limit = static_cast<int64_t>(1) << LatencyHistogram::MAX_VALUE_BITS;
+  EXPECT_EQ(LatencyHistogram::BUCKET_COUNT - 1, LatencyHistogram::bucketIndex(limit - 1));
+  EXPECT_EQ(LatencyHistogram::BUCKET_COUNT - 1, LatencyHistogram::bucketIndex(limit));
+  EXPECT_EQ(LatencyHistogram::BUCKET_COUNT - 1, LatencyHistogram::bucketIndex(limit * 1000));
+  EXPECT_EQ(limit - 1, LatencyHistogram::bucketHighestValue(LatencyHistogram::BUCKET_COUNT - 1));
+}
+
+TEST(LatencyHistogramTest, EmptySnapshotIsZero)
+{
+  std::unique_ptr<LatencyHistogram> histogram(new LatencyHistogram());
+  const LatencyHistogram::Snapshot snapshot = histogram->takeSnapshot();
+  EXPECT_EQ(0u, snapshot.count);
+  EXPECT_EQ(0, snapshot.p50);
+  EXPECT_EQ(0, snapshot.p999);
+  EXPECT_EQ(0, snapshot.max);
+}
+
+TEST(LatencyHistogramTest, PercentilesOfAUniformDistribution)
+{
+  std::unique_ptr<LatencyHistogram> histogram(new LatencyHistogram());
+  for (int64_t value = 1; value <= 1000; value++)
+    histogram->record(value);
+
+  const LatencyHistogram::Snapshot snapshot = histogram->takeSnapshot();
+  EXPECT_EQ(1000u, snapshot.count);
+  EXPECT_EQ(1000, snapshot.max);
+
+  // A percentile is the highest value of the bucket of its rank, so it is at most 1 / SUB_BUCKET_COUNT above it.
+  const int64_t ranks[] = { 500, 900, 990, 999 };
+  const int64_t percentiles[] = { snapshot.p50, snapshot.p90, snapshot.p99, snapshot.p999 };
+  for (int i = 0; i < 4; i++)
+  {
+    EXPECT_GE(percentiles[i], ranks[i]);
+    EXPECT_LE(percentiles[i], ranks[i] + ranks[i] / static_cast<int64_t>(LatencyHistogram::SUB_BUCKET_COUNT));
+    EXPECT_LE(percentiles[i], snapshot.max);
+  }
+  EXPECT_EQ(LatencyHistogram::bucketHighestValue(LatencyHistogram::bucketIndex(500)), snapshot.p50);
+}
+
+TEST(LatencyHistogramTest, PercentilesNeverExceedTheMaximum)
+{
+  std::unique_ptr<LatencyHistogram> histogram(new LatencyHistogram());
+  histogram->record(1000);
+  ASSERT_GT(LatencyHistogram::bucketHighestValue(LatencyHistogram::bucketIndex(1000)), 1000);
+
+  const LatencyHistogram::Snapshot snapshot = histogram->takeSnapshot();
+  EXPECT_EQ(1000, snapshot.p50);
+  EXPECT_EQ(1000, snapshot.p999);
+  EXPECT_EQ(1000, snapshot.max);
+}
+
+TEST(LatencyHistogramTest, OutliersOnlyMoveTheHighPercentiles)
+{
+  std::unique_ptr<LatencyHistogram> histogram(new LatencyHistogram());
+  for (int i = 0; i < 995; i++)
+    histogram->record(10);
+  for (int i = 0; i < 5; i++)
+    histogram->record(1000000);
+
+  const LatencyHistogram::Snapshot snapshot = histogram->takeSnapshot();
+  EXPECT_EQ(10, snapshot.p50);
+  EXPECT_EQ(10, snapshot.p90);
+  EXPECT_EQ(10, snapshot.p99);
+  EXPECT_EQ(1000000, snapshot.p999);
+  EXPECT_EQ(1000000, snapshot.max);
+}
+
+TEST(LatencyHistogramTest, SnapshotEmptiesTheHistogram)
+{
+  std::unique_ptr<LatencyHistogram> histogram(new LatencyHistogram());
+  histogram->record(-5);
+  histogram->record(40);
+  LatencyHistogram::Snapshot snapshot = histogram->takeSnapshot();
+  EXPECT_EQ(2u, snapshot.count);
+  EXPECT_EQ(0, snapshot.p50);
+  EXPECT_EQ(40, snapshot.max);
+
+  histogram->record(3);
+  snapshot = histogram->takeSnapshot();
+  EXPECT_EQ(1u, snapshot.count);
+  EXPECT_EQ(3, snapshot.p50);
+  EXPECT_EQ(3, snapshot.max);
+  EXPECT_EQ(3u, histogram->totalCount());
+}
@@ -0,0 +1,212 @@
+/*!*******************************************************************************************
+ *  \file       process_clock_test.cpp
+ *  \brief      Tests of ManualClock.
+ *  \details    This file checks that the ticks of a ManualClock wait for the loops in lockstep, both with
+ *              the clock alone and with the loop of runAtRate().
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/process_clock.h"
+#include "../include/in_process_transport.h"
+#include "../include/robot_process.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace
+{
+const int64_t PERIOD_NS = 10000000;
+
+// Process that counts its cycles and records the time of the clock at every one.
+class CountingProcess : public RobotProcess
+{
+public:
+  std::atomic<int> runs;
+  std::vector<int64_t> run_times;
+
+  CountingProcess() : runs(0)
+  {
+  }
+
+  ~CountingProcess()
+  {
+    shutdown();
+  }
+
+protected:
+  void ownSetUp()
+  {
+  }
+
+  void ownStart()
+  {
+  }
+
+  void ownStop()
+  {
+  }
+
+  void ownRun()
+  {
+    run_times.push_back(getClock()->now());
+    runs++;
+  }
+};
+}  // namespace
+
+TEST(ManualClockTest, AdvancesOnlyWhenStepped)
+{
+  ManualClock clock(1000);
+  EXPECT_TRUE(clock.isSimulated());
+  EXPECT_EQ(1000, clock.now());
+  EXPECT_EQ(0u, clock.getTick());
+
+  clock.step(500);
+  EXPECT_EQ(1500, clock.now());
+  EXPECT_EQ(1u, clock.getTick());
+
+  // A time in the past does not move the clock back, but it is still a tick.
+  clock.advanceTo(1200);
+  EXPECT_EQ(1500, clock.now());
+  EXPECT_EQ(2u, clock.getTick());
+
+  clock.step(-100);
+  EXPECT_EQ(1500, clock.now());
+  EXPECT_EQ(3u, clock.getTick());
+}
+
+TEST(ManualClockTest, StepWaitsForEveryParticipant)
+{
+  const int PARTICIPANTS = 3;
+  const int TICKS = 50;
+  ManualClock clock;
+
+  std::atomic<bool> finished(false);
+  std::vector<std::atomic<int>> completed(PARTICIPANTS);
+  std::vector<std::thread> participants;
+  std::atomic<int> joined(0);
+  for (int i = 0; i < PARTICIPANTS; i++)
+  {
+    completed[i] = 0;
+    participants.emplace_back([&, i]() {
+      uint64_t tick = clock.joinLockstep();
+      joined++;
+      while (!finished)
+      {
+        if (!clock.waitForTick(tick, tick))
+          continue;
+        // The slowest participants finish their cycle long after the tick, so the step has to wait for them.
+        std::this_thread::sleep_for(std::chrono::microseconds(200 * i));
+        completed[i]++;
+        clock.completeTick(tick);
+      }
+      clock.leaveLockstep(tick);
+    });
+  }
+  while (joined.load() < PARTICIPANTS)
+    std::this_thread::yield();
+
+  for (int tick = 1; tick <= TICKS; tick++)
+  {
+    clock.step(PERIOD_NS);
+    for (int i = 0; i < PARTICIPANTS; i++)
+      ASSERT_EQ(tick, completed[i].load()) << "participant " << i;
+  }
+
+  finished = true;
+  clock.step(PERIOD_NS);
+  for (std::thread& participant : participants)
+    participant.join();
+}
+
+TEST(ManualClockTest, LeavingParticipantDoesNotBlockTheStep)
+{
+  ManualClock clock;
+  const uint64_t joined_tick = clock.joinLockstep();
+
+  // The participant leaves without completing the tick it was counted in.
+  std::thread stepper([&clock]() { clock.step(PERIOD_NS); });
+  while (clock.getTick() == joined_tick)
+    std::this_thread::yield();
+  clock.leaveLockstep(joined_tick);
+  stepper.join();
+
+  // Without participants, steps return at once.
+  clock.step(PERIOD_NS);
+  EXPECT_EQ(2 * PERIOD_NS, clock.now());
+}
+
+TEST(ManualClockTest, RunAtRateExecutesOneCyclePerTick)
+{
+  const int TICKS = 100;
+  std::shared_ptr<ManualClock> clock = std::make_shared<ManualClock>();
+  std::shared_ptr<InProcessTransport> transport = std::make_shared<InProcessTransport>("/lockstep_test");
+  transport->setParam("lockstep", true);
+  transport->setParam("state_board", false);
+  transport->setParam("heartbeat_rate", 0.0);
+  transport->setParam("metrics_rate", 0.0);
+
+  CountingProcess process;
+  process.setTransport(transport);
+  process.setClock(clock);
+  process.setUp();
+  ASSERT_TRUE(transport->requestStart());
+
+  std::thread loop([&process]() { process.runAtRate(1e9 / PERIOD_NS); });
+
+  // The loop takes part in the lockstep from the first tick after it joins, so the clock is stepped until it runs.
+  const std::chrono::steady_clock::time_point limit = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (process.runs.load() == 0 && std::chrono::steady_clock::now() < limit)
+  {
+    clock->step(PERIOD_NS);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_GT(process.runs.load(), 0);
+
+  const int first_runs = process.runs.load();
+  for (int tick = 1; tick <= TICKS; tick++)
+  {
+    clock->step(PERIOD_NS);
+    ASSERT_EQ(first_runs + tick, process.runs.load()) << "tick " << tick;
+    ASSERT_EQ(clock->now(), process.run_times.back()) << "tick " << tick;
+  }
+
+  transport->requestShutdown();
+  loop.join();
+  EXPECT_EQ(static_cast<uint64_t>(first_runs + TICKS), process.getRunStatistics().cycles);
+  EXPECT_EQ(0u, process.getRunStatistics().missed_deadlines);
+}
@@ -0,0 +1,161 @@
+/*!*******************************************************************************************
+ *  \file       process_state_board_test.cpp
+ *  \brief      Tests of ProcessStateBoard.
+ *  \details    This file checks the ownership of the slots of a ProcessStateBoard by the processes of one
+ *              or several OS processes, and the permissions of its segment.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/process_state_board.h"
+
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <gtest/gtest.h>
+
+namespace
+{
+// Uses a board of its own, named after the PID of the test, and removes it afterwards.
+class ProcessStateBoardTest : public ::testing::Test
+{
+protected:
+  std::string hostname;
+
+  void SetUp()
+  {
+    hostname = "board_test_" + std::to_string(getpid());
+    shm_unlink(segment().c_str());
+  }
+
+  void TearDown()
+  {
+    shm_unlink(segment().c_str());
+  }
+
+  std::string segment() const
+  {
+    return "/robot_process_board_" + hostname;
+  }
+
+  std::vector<std::string> registeredNames() const
+  {
+    std::vector<ProcessStateBoard::Entry> entries;
+    std::vector<std::string> names;
+    if (ProcessStateBoard::read(hostname, entries))
+    {
+      for (const ProcessStateBoard::Entry& entry : entries)
+        names.push_back(entry.name);
+    }
+    return names;
+  }
+};
+}  // namespace
+
+TEST_F(ProcessStateBoardTest, ProcessesOfOneExecutableHaveTheirOwnSlots)
+{
+  // The processes hosted by a container share the PID, so the board tells their slots apart.
+  ProcessStateBoard first;
+  ProcessStateBoard second;
+  ASSERT_TRUE(first.registerProcess(hostname, "/first"));
+  ASSERT_TRUE(second.registerProcess(hostname, "/second"));
+  first.updateState(ProcessState::RUNNING);
+  second.updateState(ProcessState::PAUSED);
+
+  std::vector<ProcessStateBoard::Entry> entries;
+  ASSERT_TRUE(ProcessStateBoard::read(hostname, entries));
+  ASSERT_EQ(2u, entries.size());
+  EXPECT_STREQ("/first", entries[0].name);
+  EXPECT_EQ(ProcessState::RUNNING, entries[0].state);
+  EXPECT_STREQ("/second", entries[1].name);
+  EXPECT_EQ(ProcessState::PAUSED, entries[1].state);
+  EXPECT_EQ(entries[0].pid, entries[1].pid);
+
+  first.unregisterProcess();
+  EXPECT_EQ(std::vector<std::string>{ "/second" }, registeredNames());
+
+  // The released slot is the first free one, so the next process takes it.
+  ProcessStateBoard third;
+  ASSERT_TRUE(third.registerProcess(hostname, "/third"));
+  EXPECT_EQ((std::vector<std::string>{ "/third", "/second" }), registeredNames());
+}
+
+TEST_F(ProcessStateBoardTest, SlotOfADeadProcessIsReused)
+{
+  int ready[2];
+  ASSERT_EQ(0, pipe(ready));
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0)
+  {
+    // The child dies without unregistering.
+    ProcessStateBoard board;
+    const char registered = board.registerProcess(hostname, "/dead") ? 1 : 0;
+    if (write(ready[1], &registered, 1) != 1)
+      _exit(1);
+    _exit(0);
+  }
+
+  char registered = 0;
+  ASSERT_EQ(1, read(ready[0], &registered, 1));
+  ASSERT_EQ(1, registered);
+  waitpid(child, nullptr, 0);
+  close(ready[0]);
+  close(ready[1]);
+
+  // Its slot is still read, so a supervisor can see that the process died, until another process takes it.
+  EXPECT_EQ(std::vector<std::string>{ "/dead" }, registeredNames());
+  ProcessStateBoard board;
+  ASSERT_TRUE(board.registerProcess(hostname, "/alive"));
+  EXPECT_EQ(std::vector<std::string>{ "/alive" }, registeredNames());
+}
+
+TEST_F(ProcessStateBoardTest, SegmentIsWritableByEveryUser)
+{
+  const mode_t previous_mask = umask(077);
+  ProcessStateBoard board;
+  const bool registered = board.registerProcess(hostname, "/process");
+  umask(previous_mask);
+  ASSERT_TRUE(registered);
+
+  const int fd = shm_open(segment().c_str(), O_RDONLY, 0);
+  ASSERT_GE(fd, 0);
+  struct stat status;
+  ASSERT_EQ(0, fstat(fd, &status));
+  close(fd);
+  EXPECT_EQ(0666u, status.st_mode & 0777u);
+}
@@ -0,0 +1,121 @@
+/*!*******************************************************************************************
+ *  \file       process_state_test.cpp
+ *  \brief      Tests of the ProcessState transition table.
+ *  \details    This file checks isLegalTransition() against the expected transitions of every state.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/process_state.h"
+
+#include <set>
+#include <utility>
+#include <gtest/gtest.h>
+
+namespace
+{
+const ProcessState ALL_STATES[] = { ProcessState::CREATED, ProcessState::READY_TO_START, ProcessState::RUNNING,
+                                    ProcessState::PAUSED,  ProcessState::STARTING,       ProcessState::STOPPING,
+                                    ProcessState::STARTED, ProcessState::NOT_STARTED };
+
+// Transitions allowed by the lifecycle, written out independently of PROCESS_STATE_TRANSITIONS.
+std::set<std::pair<ProcessState, ProcessState>> expectedTransitions()
+{
+  return {
+    { ProcessState::CREATED, ProcessState::READY_TO_START },
+    { ProcessState::READY_TO_START, ProcessState::STARTING },
+    { ProcessState::STARTING, ProcessState::RUNNING },
+    { ProcessState::RUNNING, ProcessState::STOPPING },
+    { ProcessState::RUNNING, ProcessState::PAUSED },
+    { ProcessState::PAUSED, ProcessState::RUNNING },
+    { ProcessState::PAUSED, ProcessState::STOPPING },
+    { ProcessState::STOPPING, ProcessState::READY_TO_START },
+    { ProcessState::STARTED, ProcessState::RUNNING },
+    { ProcessState::STARTED, ProcessState::STOPPING },
+    { ProcessState::STARTED, ProcessState::PAUSED },
+    { ProcessState::NOT_STARTED, ProcessState::READY_TO_START },
+    { ProcessState::NOT_STARTED, ProcessState::STARTING },
+  };
+}
+}  // namespace
+
+static_assert(isLegalTransition(ProcessState::READY_TO_START, ProcessState::STARTING),
+              "isLegalTransition() must be usable at compile time");
+
+TEST(ProcessStateTest, LegalTransitionsMatchTheLifecycle)
+{
+  const std::set<std::pair<ProcessState, ProcessState>> expected = expectedTransitions();
+  for (ProcessState from : ALL_STATES)
+  {
+    for (ProcessState to : ALL_STATES)
+    {
+      EXPECT_EQ(expected.count(std::make_pair(from, to)) != 0, isLegalTransition(from, to))
+          << processStateName(from) << " -> " << processStateName(to);
+    }
+  }
+}
+
+TEST(ProcessStateTest, NoTransitionLeadsToTheFormerStates)
+{
+  for (ProcessState from : ALL_STATES)
+  {
+    EXPECT_FALSE(isLegalTransition(from, ProcessState::STARTED)) << processStateName(from);
+    EXPECT_FALSE(isLegalTransition(from, ProcessState::NOT_STARTED)) << processStateName(from);
+    EXPECT_FALSE(isLegalTransition(from, from)) << processStateName(from);
+  }
+}
+
+TEST(ProcessStateTest, ValuesOutOfTheTableAreRejected)
+{
+  const ProcessState undefined = static_cast<ProcessState>(0);
+  const ProcessState out_of_range = static_cast<ProcessState>(PROCESS_STATE_TABLE_SIZE);
+  for (ProcessState state : ALL_STATES)
+  {
+    EXPECT_FALSE(isLegalTransition(undefined, state));
+    EXPECT_FALSE(isLegalTransition(out_of_range, state));
+    EXPECT_FALSE(isLegalTransition(state, out_of_range));
+  }
+  EXPECT_STREQ("UNDEFINED", processStateName(undefined));
+  EXPECT_STREQ("UNDEFINED", processStateName(out_of_range));
+}
+
+TEST(ProcessStateTest, NamesFollowTheEnum)
+{
+  EXPECT_STREQ("CREATED", processStateName(ProcessState::CREATED));
+  EXPECT_STREQ("READY_TO_START", processStateName(ProcessState::READY_TO_START));
+  EXPECT_STREQ("RUNNING", processStateName(ProcessState::RUNNING));
+  EXPECT_STREQ("PAUSED", processStateName(ProcessState::PAUSED));
+  EXPECT_STREQ("STARTING", processStateName(ProcessState::STARTING));
+  EXPECT_STREQ("STOPPING", processStateName(ProcessState::STOPPING));
+  EXPECT_STREQ("STARTED", processStateName(ProcessState::STARTED));
+  EXPECT_STREQ("NOT_STARTED", processStateName(ProcessState::NOT_STARTED));
+}
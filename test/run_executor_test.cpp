@@ -0,0 +1,254 @@
+/*!*******************************************************************************************
+ *  \file       run_executor_test.cpp
+ *  \brief      Tests of RunExecutor.
+ *  \details    This file checks the earliest deadline first order of RunExecutor and how it accounts the
+ *              releases that expire during an execution, driving it with a ManualClock.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/run_executor.h"
+#include "../include/in_process_transport.h"
+#include "../include/robot_process.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace
+{
+const int64_t MILLISECOND_NS = 1000000;
+const int64_t START_NS = 1000 * MILLISECOND_NS;
+
+// Names of the jobs in order of execution.
+class ExecutionLog
+{
+private:
+  mutable std::mutex mutex;
+  std::vector<std::string> names;
+
+public:
+  void add(const std::string& name)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    names.push_back(name);
+  }
+
+  std::vector<std::string> get() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return names;
+  }
+
+  //! Waits until 'count' executions have been logged, giving up after a few seconds.
+  bool waitFor(size_t count) const
+  {
+    const std::chrono::steady_clock::time_point limit = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (get().size() < count)
+    {
+      if (std::chrono::steady_clock::now() > limit)
+        return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+  }
+};
+
+// Process whose ownRun() takes 'run_duration_ns' of the simulated clock.
+class SlowProcess : public RobotProcess
+{
+public:
+  std::shared_ptr<ManualClock> manual_clock;
+  int64_t run_duration_ns;
+  ExecutionLog* log;
+
+  SlowProcess(const std::shared_ptr<ManualClock>& process_clock, int64_t duration_ns, ExecutionLog* execution_log)
+    : manual_clock(process_clock), run_duration_ns(duration_ns), log(execution_log)
+  {
+  }
+
+  ~SlowProcess()
+  {
+    shutdown();
+  }
+
+protected:
+  void ownSetUp()
+  {
+  }
+
+  void ownStart()
+  {
+  }
+
+  void ownStop()
+  {
+  }
+
+  void ownRun()
+  {
+    manual_clock->step(run_duration_ns);
+    log->add(processName());
+  }
+};
+}  // namespace
+
+TEST(RunExecutorTest, RejectsRatesThatAreNotPositive)
+{
+  RunExecutor executor;
+  EXPECT_EQ(RunExecutor::INVALID_JOB, executor.addJob("zero", 0, []() {}));
+  EXPECT_EQ(RunExecutor::INVALID_JOB, executor.addJob("negative", -5, []() {}));
+  EXPECT_EQ(0u, executor.addJob("valid", 10, []() {}));
+  EXPECT_EQ(1u, executor.getStatistics().size());
+}
+
+TEST(RunExecutorTest, ExecutesTheEarliestDeadlineFirst)
+{
+  std::shared_ptr<ManualClock> clock = std::make_shared<ManualClock>(START_NS);
+  ExecutionLog log;
+  RunExecutor executor;
+  executor.setClock(clock);
+  executor.addJob("10Hz", 10, [&log]() { log.add("10Hz"); });
+  executor.addJob("100Hz", 100, [&log]() { log.add("100Hz"); });
+  executor.addJob("50Hz", 50, [&log]() { log.add("50Hz"); });
+
+  // Every job is released at start, and the deadline of a release is the next one.
+  executor.start(1);
+  ASSERT_TRUE(log.waitFor(3));
+  EXPECT_EQ((std::vector<std::string>{ "100Hz", "50Hz", "10Hz" }), log.get());
+
+  // At 10 ms only the 100 Hz job is released again; at 20 ms both faster jobs are, the 100 Hz one with the earlier
+  // deadline.
+  clock->step(10 * MILLISECOND_NS);
+  ASSERT_TRUE(log.waitFor(4));
+  clock->step(10 * MILLISECOND_NS);
+  ASSERT_TRUE(log.waitFor(6));
+  executor.stop();
+
+  const std::vector<std::string> order = log.get();
+  ASSERT_EQ(6u, order.size());
+  EXPECT_EQ("100Hz", order[3]);
+  EXPECT_EQ("100Hz", order[4]);
+  EXPECT_EQ("50Hz", order[5]);
+}
+
+TEST(RunExecutorTest, SkipsTheReleasesThatExpireDuringAnExecution)
+{
+  std::shared_ptr<ManualClock> clock = std::make_shared<ManualClock>(START_NS);
+  ExecutionLog log;
+  RunExecutor executor;
+  executor.setClock(clock);
+
+  // The job takes 35 ms of a 10 ms period, so the releases at 10, 20 and 30 ms expire and the next one is at 40 ms.
+  executor.addJob("slow", 100, [&]() {
+    if (log.get().empty())
+      clock->step(35 * MILLISECOND_NS);
+    log.add("slow");
+  });
+  executor.start(1);
+  ASSERT_TRUE(log.waitFor(1));
+
+  clock->advanceTo(START_NS + 39 * MILLISECOND_NS);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(1u, log.get().size());
+
+  clock->advanceTo(START_NS + 40 * MILLISECOND_NS);
+  ASSERT_TRUE(log.waitFor(2));
+  executor.stop();
+
+  const RunExecutor::JobStatistics statistics = executor.getStatistics()[0];
+  EXPECT_EQ(2u, statistics.runs);
+  EXPECT_EQ(1u, statistics.overruns);
+  EXPECT_EQ(3u, statistics.skipped_releases);
+}
+
+TEST(RunExecutorTest, MeasuresTheLatenessOfTheReleases)
+{
+  std::shared_ptr<ManualClock> clock = std::make_shared<ManualClock>(START_NS);
+  ExecutionLog log;
+  RunExecutor executor;
+  executor.setClock(clock);
+
+  // With a single thread, the 50 Hz job waits for the 100 Hz one, which takes 5 ms and meets its deadline.
+  executor.addJob("50Hz", 50, [&log]() { log.add("50Hz"); });
+  executor.addJob("100Hz", 100, [&]() {
+    clock->step(5 * MILLISECOND_NS);
+    log.add("100Hz");
+  });
+  executor.start(1);
+  ASSERT_TRUE(log.waitFor(2));
+  executor.stop();
+
+  const std::vector<RunExecutor::JobStatistics> statistics = executor.getStatistics();
+  EXPECT_EQ(5 * MILLISECOND_NS, statistics[0].max_lateness_ns);
+  EXPECT_EQ(0u, statistics[0].overruns);
+  EXPECT_EQ(0, statistics[1].max_lateness_ns);
+  EXPECT_EQ(0u, statistics[1].overruns);
+}
+
+TEST(RunExecutorTest, SkippedReleasesAreTheMissedDeadlinesOfTheProcess)
+{
+  std::shared_ptr<ManualClock> clock = std::make_shared<ManualClock>(START_NS);
+  std::shared_ptr<InProcessTransport> transport = std::make_shared<InProcessTransport>("/slow_process");
+  transport->setParam("state_board", false);
+  transport->setParam("heartbeat_rate", 0.0);
+  transport->setParam("metrics_rate", 0.0);
+
+  ExecutionLog log;
+  SlowProcess process(clock, 25 * MILLISECOND_NS, &log);
+  process.setTransport(transport);
+  process.setClock(clock);
+  process.setUp();
+  ASSERT_TRUE(transport->requestStart());
+
+  RunExecutor executor;
+  executor.setClock(clock);
+  executor.addProcess(process, 100);
+  executor.start(1);
+  ASSERT_TRUE(log.waitFor(1));
+  executor.stop();
+
+  // The run takes 25 ms of a 10 ms period: the releases at 10 and 20 ms expire.
+  const RunExecutor::JobStatistics statistics = executor.getStatistics()[0];
+  EXPECT_EQ(1u, statistics.runs);
+  EXPECT_EQ(1u, statistics.overruns);
+  EXPECT_EQ(2u, statistics.skipped_releases);
+
+  const RobotProcess::RunStatistics run_statistics = process.getRunStatistics();
+  EXPECT_EQ(1u, run_statistics.cycles);
+  EXPECT_EQ(statistics.skipped_releases, run_statistics.missed_deadlines);
+  transport->requestShutdown();
+}
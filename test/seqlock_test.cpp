@@ -0,0 +1,157 @@
+/*!*******************************************************************************************
+ *  \file       seqlock_test.cpp
+ *  \brief      Tests of SeqLock.
+ *  \details    This file checks that SeqLock readers retry instead of returning a value torn by a write.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/seqlock.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace
+{
+// Large enough for a copy to overlap with a write many times. Every word of a consistent value is the same.
+struct Block
+{
+  uint64_t words[64];
+};
+
+Block makeBlock(uint64_t word)
+{
+  Block block;
+  for (uint64_t& w : block.words)
+    w = word;
+  return block;
+}
+
+bool isConsistent(const Block& block)
+{
+  for (uint64_t w : block.words)
+  {
+    if (w != block.words[0])
+      return false;
+  }
+  return true;
+}
+}  // namespace
+
+TEST(SeqLockTest, StartsZeroedAndReturnsTheLastValue)
+{
+  SeqLock<Block> lock;
+  EXPECT_TRUE(isConsistent(lock.load()));
+  EXPECT_EQ(0u, lock.load().words[0]);
+
+  lock.store(makeBlock(7));
+  lock.store(makeBlock(8));
+  const Block block = lock.load();
+  EXPECT_TRUE(isConsistent(block));
+  EXPECT_EQ(8u, block.words[0]);
+}
+
+TEST(SeqLockTest, ReadersNeverSeeATornValue)
+{
+  const int READERS = 3;
+  const int READS_PER_READER = 20000;
+
+  SeqLock<Block> lock;
+  std::atomic<int> finished_readers(0);
+  std::atomic<uint64_t> torn_reads(0);
+  std::atomic<uint64_t> backward_reads(0);
+
+  // The readers copy the value while it is being written over and over, so with several cores many of their copies
+  // overlap with a write and have to be retried.
+  std::vector<std::thread> readers;
+  for (int i = 0; i < READERS; i++)
+  {
+    readers.emplace_back([&]() {
+      uint64_t last = 0;
+      for (int read = 0; read < READS_PER_READER; read++)
+      {
+        const Block block = lock.load();
+        if (!isConsistent(block))
+          torn_reads++;
+        if (block.words[0] < last)
+          backward_reads++;
+        last = block.words[0];
+      }
+      finished_readers++;
+    });
+  }
+
+  uint64_t word = 0;
+  while (finished_readers.load() < READERS)
+  {
+    lock.store(makeBlock(++word));
+    std::this_thread::yield();
+  }
+  for (std::thread& reader : readers)
+    reader.join();
+
+  EXPECT_EQ(0u, torn_reads.load());
+  EXPECT_EQ(0u, backward_reads.load());
+  EXPECT_EQ(word, lock.load().words[0]);
+}
+
+TEST(SeqLockTest, LoadWaitsForTheWriteInProgress)
+{
+  static_assert(std::is_standard_layout<SeqLock<Block>>::value, "The sequence must be the first member");
+
+  SeqLock<Block> lock;
+  lock.store(makeBlock(1));
+
+  // The sequence is the first member of the lock, so making it odd is what store() does when it starts a write.
+  std::atomic<uint32_t>& sequence = *reinterpret_cast<std::atomic<uint32_t>*>(&lock);
+  sequence.fetch_add(1);
+
+  std::atomic<bool> loaded(false);
+  Block block = makeBlock(0);
+  std::thread reader([&]() {
+    block = lock.load();
+    loaded = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(loaded.load());
+
+  sequence.fetch_add(1);
+  reader.join();
+  EXPECT_TRUE(loaded.load());
+  EXPECT_TRUE(isConsistent(block));
+  EXPECT_EQ(1u, block.words[0]);
+}
@@ -0,0 +1,196 @@
+/*!*******************************************************************************************
+ *  \file       work_stealing_pool_test.cpp
+ *  \brief      Tests of WorkStealingPool.
+ *  \details    This file checks that the tasks of a WorkStealingPool are stolen by idle threads and that waiting
+ *              for a TaskGroup returns once all its tasks have finished.
+ *  \authors    Enrique Ortiz, Yolanda de la Hoz, Martin Molina, David Palacios,
+ *              Alberto Camporredondo
+ *  \copyright  Copyright (c) 2018 Universidad Politecnica de Madrid
+ *              All Rights Reserved
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ********************************************************************************/
+
+
+#include "../include/work_stealing_pool.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace
+{
+// Waits until a condition holds, giving up after a few seconds so a broken pool fails instead of hanging.
+template <class Condition>
+bool waitUntil(const Condition& condition)
+{
+  const std::chrono::steady_clock::time_point limit = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!condition())
+  {
+    if (std::chrono::steady_clock::now() > limit)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+}  // namespace
+
+TEST(WorkStealingPoolTest, PoolWithoutThreadsRunsTasksInTheCaller)
+{
+  WorkStealingPool pool;
+  const std::thread::id caller = std::this_thread::get_id();
+  std::thread::id executor;
+  {
+    WorkStealingPool::TaskGroup group(pool);
+    group.run([&executor]() { executor = std::this_thread::get_id(); });
+  }
+  EXPECT_EQ(caller, executor);
+}
+
+TEST(WorkStealingPoolTest, ParallelForVisitsEveryIndexOnce)
+{
+  WorkStealingPool pool;
+  pool.start(3);
+  std::vector<std::atomic<int>> visits(10000);
+  for (std::atomic<int>& count : visits)
+    count = 0;
+
+  pool.parallelFor(0, visits.size(), [&visits](size_t i) { visits[i]++; }, 7);
+  for (size_t i = 0; i < visits.size(); i++)
+    ASSERT_EQ(1, visits[i].load()) << "index " << i;
+  pool.stop();
+}
+
+TEST(WorkStealingPoolTest, TasksOfABusyThreadAreStolen)
+{
+  const int CHILDREN = 32;
+  WorkStealingPool pool;
+  pool.start(3);
+
+  // A task of the pool queues its children in its own queue and then spins without executing them, so they can only
+  // finish if the other threads steal them.
+  std::atomic<bool> parent_started(false);
+  std::atomic<int> finished_children(0);
+  std::thread::id parent_thread;
+  std::vector<std::thread::id> child_threads(CHILDREN);
+  WorkStealingPool::TaskGroup children(pool);
+  WorkStealingPool::TaskGroup parent(pool);
+  parent.run([&]() {
+    parent_thread = std::this_thread::get_id();
+    for (int i = 0; i < CHILDREN; i++)
+    {
+      children.run([&, i]() {
+        child_threads[i] = std::this_thread::get_id();
+        finished_children++;
+      });
+    }
+    parent_started = true;
+    waitUntil([&]() { return finished_children.load() == CHILDREN; });
+  });
+
+  // The test thread does not wait for the groups until the children have finished, so it does not execute them.
+  ASSERT_TRUE(waitUntil([&]() { return parent_started.load(); }));
+  ASSERT_TRUE(waitUntil([&]() { return finished_children.load() == CHILDREN; }));
+  parent.wait();
+  children.wait();
+
+  for (int i = 0; i < CHILDREN; i++)
+    EXPECT_NE(parent_thread, child_threads[i]) << "child " << i;
+  pool.stop();
+}
+
+TEST(WorkStealingPoolTest, WaitSleepsUntilTheLastTaskFinishes)
+{
+  WorkStealingPool pool;
+  pool.start(2);
+
+  // The waiting thread runs out of tasks to execute long before the slow one finishes, so it goes to sleep and has
+  // to be woken up by it.
+  std::atomic<bool> slow_started(false);
+  std::atomic<bool> slow_finished(false);
+  WorkStealingPool::TaskGroup group(pool);
+  group.run([&]() {
+    slow_started = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    slow_finished = true;
+  });
+  ASSERT_TRUE(waitUntil([&]() { return slow_started.load(); }));
+
+  group.wait();
+  EXPECT_TRUE(slow_finished.load());
+  pool.stop();
+}
+
+TEST(WorkStealingPoolTest, NestedGroupsAndFullQueuesFinish)
+{
+  WorkStealingPool pool;
+  pool.start(2);
+
+  // Every outer task waits for more inner tasks than its queue holds, so some of them are executed in place and the
+  // waiting threads execute the tasks of the others.
+  const int OUTER = 8;
+  const int INNER = static_cast<int>(WorkStealingPool::QUEUE_CAPACITY) * 2;
+  std::atomic<int> executed(0);
+  {
+    WorkStealingPool::TaskGroup outer(pool);
+    for (int i = 0; i < OUTER; i++)
+    {
+      outer.run([&]() {
+        WorkStealingPool::TaskGroup inner(pool);
+        for (int j = 0; j < INNER; j++)
+          inner.run([&executed]() { executed++; });
+      });
+    }
+  }
+  EXPECT_EQ(OUTER * INNER, executed.load());
+  pool.stop();
+}
+
+TEST(WorkStealingPoolTest, LargeTasksAreDestroyedOnce)
+{
+  WorkStealingPool pool;
+  pool.start(2);
+
+  // The array does not fit in the task, so the callable is allocated and has to be released after it runs.
+  std::shared_ptr<int> resource = std::make_shared<int>(0);
+  std::array<char, 2 * WorkStealingPool::Task::INLINE_SIZE> payload{};
+  payload[0] = 1;
+  std::atomic<int> sum(0);
+  {
+    WorkStealingPool::TaskGroup group(pool);
+    for (int i = 0; i < 100; i++)
+      group.run([resource, payload, &sum]() { sum += payload[0]; });
+  }
+  EXPECT_EQ(100, sum.load());
+  EXPECT_EQ(1, resource.use_count());
+  pool.stop();
+}